@@ -0,0 +1,23 @@
+#include "backoff.h"
+
+#include "Arduino.h"
+
+Backoff::Backoff(uint32_t initial_delay, uint32_t max_delay)
+    : initial_delay{initial_delay}, max_delay{max_delay} {}
+
+uint32_t Backoff::next_delay() {
+  uint32_t window = initial_delay;
+  for (uint16_t i = 0; i < failures && window < max_delay; i++) {
+    window *= 2;
+  }
+  if (window > max_delay) {
+    window = max_delay;
+  }
+  if (failures < UINT16_MAX) {
+    failures++;
+  }
+  // "equal jitter": wait at least half of the window so that the
+  // backoff keeps growing, and spread the rest randomly
+  uint32_t half = window / 2;
+  return half + random(half + 1);
+}
@@ -0,0 +1,43 @@
+#ifndef _backoff_H_
+#define _backoff_H_
+
+#include <stdint.h>
+
+/**
+ * Backoff computes retry delays that grow exponentially with each
+ * consecutive failure, up to a maximum. The returned delays are
+ * randomized ("jittered") so that a number of devices failing at the
+ * same moment, for example after a server restart, don't all retry
+ * in lockstep.
+ */
+class Backoff {
+ public:
+  /**
+   * @param initial_delay The backoff window (ms) after the first failure
+   * @param max_delay The largest backoff window (ms)
+   */
+  Backoff(uint32_t initial_delay, uint32_t max_delay);
+
+  /**
+   * Returns the number of milliseconds to wait before the next retry
+   * and widens the backoff window for the following failure. The delay
+   * is picked randomly from the upper half of the current window.
+   */
+  uint32_t next_delay();
+
+  /**
+   * Shrinks the backoff window back to the initial delay. Call this
+   * once the operation has succeeded.
+   */
+  void reset() { failures = 0; }
+
+  /// Returns the number of consecutive failures seen since the last reset
+  uint16_t get_failures() { return failures; }
+
+ private:
+  uint32_t initial_delay;
+  uint32_t max_delay;
+  uint16_t failures = 0;
+};
+
+#endif
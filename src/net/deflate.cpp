@@ -0,0 +1,489 @@
+#include "deflate.h"
+
+#include <string.h>
+
+// Size of the match finder hash table
+#define DEFLATE_HASH_BITS 8
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+
+// Number of earlier positions checked for each match
+#ifndef DEFLATE_MAX_CHAIN
+#define DEFLATE_MAX_CHAIN 16
+#endif
+
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+
+// Positions are stored in 16 bits, so longer messages are compressed
+// in chunks that don't share matches
+#define DEFLATE_MAX_CHUNK 32768
+
+static const uint16_t length_base[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {
+    1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,    49,    65,    97,    129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                       4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                       9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// The trailer removed from each permessage-deflate message
+static const uint8_t message_trailer[4] = {0x00, 0x00, 0xff, 0xff};
+
+DeflateEncoder::DeflateEncoder(uint8_t window_bits) {
+  if (window_bits < 8) {
+    window_bits = 8;
+  } else if (window_bits > 15) {
+    window_bits = 15;
+  }
+  window_size = 1 << window_bits;
+}
+
+DeflateEncoder::~DeflateEncoder() {
+  delete[] head;
+  delete[] prev;
+}
+
+void DeflateEncoder::put_bits(uint32_t value, uint8_t bits) {
+  bit_buffer |= value << bit_count;
+  bit_count += bits;
+  while (bit_count >= 8) {
+    out->push_back(bit_buffer & 0xff);
+    bit_buffer >>= 8;
+    bit_count -= 8;
+  }
+}
+
+void DeflateEncoder::put_huffman(uint16_t code, uint8_t bits) {
+  // Huffman codes are packed starting with their most significant bit
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < bits; i++) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  put_bits(reversed, bits);
+}
+
+void DeflateEncoder::put_literal(uint8_t c) {
+  if (c < 144) {
+    put_huffman(0x30 + c, 8);
+  } else {
+    put_huffman(0x190 + c - 144, 9);
+  }
+}
+
+void DeflateEncoder::put_match(uint16_t length, uint16_t distance) {
+  uint8_t i = 28;
+  while (length_base[i] > length) {
+    i--;
+  }
+  uint16_t symbol = 257 + i;
+  if (symbol < 280) {
+    put_huffman(symbol - 256, 7);
+  } else {
+    put_huffman(0xc0 + symbol - 280, 8);
+  }
+  put_bits(length - length_base[i], length_extra[i]);
+
+  i = 29;
+  while (dist_base[i] > distance) {
+    i--;
+  }
+  put_huffman(i, 5);
+  put_bits(distance - dist_base[i], dist_extra[i]);
+}
+
+void DeflateEncoder::flush_bits() {
+  if (bit_count > 0) {
+    out->push_back(bit_buffer & 0xff);
+  }
+  bit_buffer = 0;
+  bit_count = 0;
+}
+
+static inline uint8_t deflate_hash(const uint8_t* p) {
+  uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+void DeflateEncoder::compress_chunk(const uint8_t* input, size_t length) {
+  memset(head, 0, DEFLATE_HASH_SIZE * sizeof(uint16_t));
+  const uint16_t mask = window_size - 1;
+
+  size_t pos = 0;
+  while (pos < length) {
+    uint16_t best_length = 0;
+    uint16_t best_distance = 0;
+    if (pos + DEFLATE_MIN_MATCH <= length) {
+      size_t max_length = length - pos;
+      if (max_length > DEFLATE_MAX_MATCH) {
+        max_length = DEFLATE_MAX_MATCH;
+      }
+      uint8_t hash = deflate_hash(input + pos);
+      uint16_t candidate = head[hash];
+      for (int chain = DEFLATE_MAX_CHAIN; candidate != 0 && chain > 0;
+           chain--) {
+        size_t start = candidate - 1;
+        size_t distance = pos - start;
+        if (distance >= window_size) {
+          break;
+        }
+        size_t match = 0;
+        while (match < max_length && input[start + match] == input[pos + match]) {
+          match++;
+        }
+        if (match > best_length) {
+          best_length = match;
+          best_distance = distance;
+          if (match == max_length) {
+            break;
+          }
+        }
+        candidate = prev[start & mask];
+      }
+      prev[pos & mask] = head[hash];
+      head[hash] = pos + 1;
+    }
+
+    if (best_length >= DEFLATE_MIN_MATCH) {
+      put_match(best_length, best_distance);
+      // index the positions inside the match for later matches
+      for (size_t p = pos + 1; p < pos + best_length; p++) {
+        if (p + DEFLATE_MIN_MATCH <= length) {
+          uint8_t hash = deflate_hash(input + p);
+          prev[p & mask] = head[hash];
+          head[hash] = p + 1;
+        }
+      }
+      pos += best_length;
+    } else {
+      put_literal(input[pos]);
+      pos++;
+    }
+  }
+}
+
+void DeflateEncoder::compress(const uint8_t* input, size_t length,
+                              std::vector<uint8_t>& output) {
+  if (head == nullptr) {
+    head = new uint16_t[DEFLATE_HASH_SIZE];
+    prev = new uint16_t[window_size];
+  }
+  out = &output;
+  bit_buffer = 0;
+  bit_count = 0;
+
+  // a single, non-final block with fixed Huffman codes
+  put_bits(0, 1);
+  put_bits(1, 2);
+  for (size_t offset = 0; offset < length; offset += DEFLATE_MAX_CHUNK) {
+    size_t chunk = length - offset;
+    if (chunk > DEFLATE_MAX_CHUNK) {
+      chunk = DEFLATE_MAX_CHUNK;
+    }
+    compress_chunk(input + offset, chunk);
+  }
+  // end of block
+  put_huffman(0, 7);
+  // header of an empty, non-final stored block, padded to a full byte.
+  // Its LEN and NLEN fields are the trailer that isn't transmitted.
+  put_bits(0, 3);
+  flush_bits();
+  out = nullptr;
+}
+
+// The inflater follows the structure of Mark Adler's "puff": canonical
+// Huffman codes are decoded one bit at a time from per-length symbol
+// counts, which needs no lookup tables beyond the code lengths.
+
+namespace {
+
+struct Huffman {
+  uint16_t count[16];
+  uint16_t symbol[288];
+};
+
+struct Inflater {
+  const uint8_t* input;
+  size_t length;
+  // position in the input, including the virtual trailer
+  size_t pos;
+  uint32_t bit_buffer;
+  uint8_t bit_count;
+  bool error;
+  std::vector<uint8_t>* out;
+  size_t out_start;
+  size_t max_length;
+
+  bool input_done() { return pos >= length + sizeof(message_trailer); }
+
+  int next_byte() {
+    if (pos < length) {
+      return input[pos++];
+    }
+    if (pos < length + sizeof(message_trailer)) {
+      return message_trailer[pos++ - length];
+    }
+    error = true;
+    return 0;
+  }
+
+  uint32_t bits(uint8_t need) {
+    uint32_t value = bit_buffer;
+    while (bit_count < need) {
+      value |= (uint32_t)next_byte() << bit_count;
+      bit_count += 8;
+    }
+    bit_buffer = value >> need;
+    bit_count -= need;
+    return value & ((1UL << need) - 1);
+  }
+
+  bool put(uint8_t c) {
+    if (out->size() - out_start >= max_length) {
+      error = true;
+      return false;
+    }
+    out->push_back(c);
+    return true;
+  }
+
+  int decode(const Huffman& h) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len < 16; len++) {
+      code |= bits(1);
+      int count = h.count[len];
+      if (code - count < first) {
+        return h.symbol[index + (code - first)];
+      }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+      if (error) {
+        break;
+      }
+    }
+    error = true;
+    return -1;
+  }
+
+  bool stored() {
+    bit_buffer = 0;
+    bit_count = 0;
+    uint16_t len = next_byte();
+    len |= next_byte() << 8;
+    uint16_t nlen = next_byte();
+    nlen |= next_byte() << 8;
+    if (error || len != (uint16_t)~nlen) {
+      return false;
+    }
+    while (len--) {
+      uint8_t c = next_byte();
+      if (error || !put(c)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool codes(const Huffman& lencode, const Huffman& distcode) {
+    while (true) {
+      int symbol = decode(lencode);
+      if (error) {
+        return false;
+      }
+      if (symbol < 256) {
+        if (!put(symbol)) {
+          return false;
+        }
+      } else if (symbol == 256) {
+        return true;
+      } else {
+        symbol -= 257;
+        if (symbol >= 29) {
+          return false;
+        }
+        size_t len = length_base[symbol] + bits(length_extra[symbol]);
+        symbol = decode(distcode);
+        if (error || symbol >= 30) {
+          return false;
+        }
+        size_t distance = dist_base[symbol] + bits(dist_extra[symbol]);
+        if (error || distance > out->size() - out_start) {
+          return false;
+        }
+        while (len--) {
+          if (!put((*out)[out->size() - distance])) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+};
+
+// Builds the decoding tables from a list of code lengths.
+// Returns a negative value for an over-subscribed code.
+int build_huffman(Huffman& h, const uint8_t* lengths, int n) {
+  memset(h.count, 0, sizeof(h.count));
+  for (int symbol = 0; symbol < n; symbol++) {
+    h.count[lengths[symbol]]++;
+  }
+  if (h.count[0] == n) {
+    return 0;
+  }
+  int left = 1;
+  for (int len = 1; len < 16; len++) {
+    left <<= 1;
+    left -= h.count[len];
+    if (left < 0) {
+      return left;
+    }
+  }
+  uint16_t offsets[16];
+  offsets[1] = 0;
+  for (int len = 1; len < 15; len++) {
+    offsets[len + 1] = offsets[len] + h.count[len];
+  }
+  for (int symbol = 0; symbol < n; symbol++) {
+    if (lengths[symbol] != 0) {
+      h.symbol[offsets[lengths[symbol]]++] = symbol;
+    }
+  }
+  return left;
+}
+
+bool fixed_block(Inflater& s) {
+  Huffman lencode;
+  Huffman distcode;
+  uint8_t lengths[288];
+  int symbol = 0;
+  for (; symbol < 144; symbol++) lengths[symbol] = 8;
+  for (; symbol < 256; symbol++) lengths[symbol] = 9;
+  for (; symbol < 280; symbol++) lengths[symbol] = 7;
+  for (; symbol < 288; symbol++) lengths[symbol] = 8;
+  build_huffman(lencode, lengths, 288);
+  memset(lengths, 5, 30);
+  build_huffman(distcode, lengths, 30);
+  return s.codes(lencode, distcode);
+}
+
+bool dynamic_block(Inflater& s) {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+  Huffman lencode;
+  Huffman distcode;
+  uint8_t lengths[288 + 32];
+
+  int nlen = s.bits(5) + 257;
+  int ndist = s.bits(5) + 1;
+  int ncode = s.bits(4) + 4;
+  if (s.error || nlen > 286 || ndist > 30) {
+    return false;
+  }
+
+  int index = 0;
+  for (; index < ncode; index++) {
+    lengths[order[index]] = s.bits(3);
+  }
+  for (; index < 19; index++) {
+    lengths[order[index]] = 0;
+  }
+  if (build_huffman(lencode, lengths, 19) != 0) {
+    return false;
+  }
+
+  index = 0;
+  while (index < nlen + ndist) {
+    int symbol = s.decode(lencode);
+    if (s.error) {
+      return false;
+    }
+    if (symbol < 16) {
+      lengths[index++] = symbol;
+      continue;
+    }
+    uint8_t len = 0;
+    int repeat;
+    if (symbol == 16) {
+      if (index == 0) {
+        return false;
+      }
+      len = lengths[index - 1];
+      repeat = 3 + s.bits(2);
+    } else if (symbol == 17) {
+      repeat = 3 + s.bits(3);
+    } else {
+      repeat = 11 + s.bits(7);
+    }
+    if (index + repeat > nlen + ndist) {
+      return false;
+    }
+    while (repeat--) {
+      lengths[index++] = len;
+    }
+  }
+  if (lengths[256] == 0) {
+    return false;
+  }
+
+  // incomplete codes are only allowed for a single length
+  int err = build_huffman(lencode, lengths, nlen);
+  if (err < 0 || (err > 0 && nlen - lencode.count[0] != 1)) {
+    return false;
+  }
+  err = build_huffman(distcode, lengths + nlen, ndist);
+  if (err < 0 || (err > 0 && ndist - distcode.count[0] != 1)) {
+    return false;
+  }
+  return s.codes(lencode, distcode);
+}
+
+}  // namespace
+
+bool inflate_message(const uint8_t* input, size_t length,
+                     std::vector<uint8_t>& output, size_t max_length) {
+  Inflater s;
+  s.input = input;
+  s.length = length;
+  s.pos = 0;
+  s.bit_buffer = 0;
+  s.bit_count = 0;
+  s.error = false;
+  s.out = &output;
+  s.out_start = output.size();
+  s.max_length = max_length;
+
+  // The message normally ends with the (re-appended) empty stored
+  // block, but a server may also close it with a final block
+  bool last = false;
+  while (!last && !s.input_done()) {
+    last = s.bits(1);
+    bool ok;
+    switch (s.bits(2)) {
+      case 0:
+        ok = s.stored();
+        break;
+      case 1:
+        ok = fixed_block(s);
+        break;
+      case 2:
+        ok = dynamic_block(s);
+        break;
+      default:
+        ok = false;
+    }
+    if (!ok || s.error) {
+      output.resize(s.out_start);
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef _deflate_H_
+#define _deflate_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+/**
+ * DeflateEncoder produces raw DEFLATE (RFC 1951) data with a small,
+ * bounded window, suitable for the permessage-deflate WebSocket
+ * extension (RFC 7692) with "client_no_context_takeover": every
+ * message is compressed independently.
+ *
+ * Only fixed Huffman codes are used. Signal K deltas are short and
+ * their redundancy is in repeated strings (paths, keys), so the LZ77
+ * stage does almost all of the work, and skipping the dynamic Huffman
+ * tables keeps both the code and the RAM use small. The match finder
+ * needs 2 * (2^window_bits + 256) bytes, allocated on first use.
+ */
+class DeflateEncoder {
+ public:
+  /**
+   * @param window_bits Base-2 logarithm of the LZ77 window size (8..15).
+   *   Must not exceed the client_max_window_bits value negotiated
+   *   with the server.
+   */
+  DeflateEncoder(uint8_t window_bits = 10);
+  ~DeflateEncoder();
+
+  /**
+   * Compresses a message and appends the result to output. As required
+   * by permessage-deflate, the data ends with an empty stored block
+   * whose trailing 0x00 0x00 0xff 0xff octets are removed.
+   */
+  void compress(const uint8_t* input, size_t length,
+                std::vector<uint8_t>& output);
+
+ private:
+  uint16_t window_size;
+  // most recent position (+1) for each hash value
+  uint16_t* head = nullptr;
+  // previous position (+1) with the same hash, indexed by position
+  uint16_t* prev = nullptr;
+  // bit output state
+  std::vector<uint8_t>* out;
+  uint32_t bit_buffer;
+  uint8_t bit_count;
+  void put_bits(uint32_t value, uint8_t bits);
+  void put_huffman(uint16_t code, uint8_t bits);
+  void put_literal(uint8_t c);
+  void put_match(uint16_t length, uint16_t distance);
+  void flush_bits();
+  void compress_chunk(const uint8_t* input, size_t length);
+};
+
+/**
+ * Decompresses a permessage-deflate message (raw DEFLATE data with the
+ * trailing 0x00 0x00 0xff 0xff removed) and appends it to output.
+ * Messages must not depend on earlier ones, i.e. the server must have
+ * agreed to "server_no_context_takeover".
+ * @return false if the data is corrupt or would exceed max_length
+ */
+bool inflate_message(const uint8_t* input, size_t length,
+                     std::vector<uint8_t>& output, size_t max_length);
+
+#endif
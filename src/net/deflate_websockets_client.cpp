@@ -0,0 +1,100 @@
+#include "deflate_websockets_client.h"
+
+#include "Arduino.h"
+
+#include "net/deflate.h"
+#include "sensesp.h"
+
+#define WS_STRINGIFY_(x) #x
+#define WS_STRINGIFY(x) WS_STRINGIFY_(x)
+
+// The default header of the websocket library is kept in front
+static const char DEFLATE_EXTRA_HEADERS[] =
+    "Origin: file://\r\n"
+    "Sec-WebSocket-Extensions: permessage-deflate; "
+    "client_no_context_takeover; server_no_context_takeover; "
+    "client_max_window_bits=" WS_STRINGIFY(WS_DEFLATE_WINDOW_BITS);
+
+void DeflateWebSocketsClient::set_compression(bool enabled) {
+  compression_requested = enabled;
+  if (enabled) {
+    setExtraHeaders(DEFLATE_EXTRA_HEADERS);
+  } else {
+    setExtraHeaders("Origin: file://");
+  }
+}
+
+bool DeflateWebSocketsClient::compression_accepted() {
+  if (!compression_requested ||
+      !_client.cExtensions.startsWith("permessage-deflate")) {
+    return false;
+  }
+  // the server may only shrink our window
+  int bits_pos = _client.cExtensions.indexOf("client_max_window_bits=");
+  if (bits_pos >= 0) {
+    int bits = _client.cExtensions.substring(bits_pos + 23).toInt();
+    if (bits < WS_DEFLATE_WINDOW_BITS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DeflateWebSocketsClient::send_compressed_txt(
+    const std::vector<uint8_t>& payload) {
+  if (!isConnected()) {
+    return false;
+  }
+  size_t length = payload.size();
+  buffer.clear();
+  // FIN, RSV1 ("compressed") and the text opcode
+  buffer.push_back(0x80 | 0x40 | WSop_text);
+  // client frames are always masked
+  if (length < 126) {
+    buffer.push_back(0x80 | length);
+  } else if (length <= 0xffff) {
+    buffer.push_back(0x80 | 126);
+    buffer.push_back(length >> 8);
+    buffer.push_back(length & 0xff);
+  } else {
+    buffer.push_back(0x80 | 127);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      buffer.push_back((uint64_t)length >> shift);
+    }
+  }
+  uint8_t mask[4];
+  for (int i = 0; i < 4; i++) {
+    mask[i] = random(0x100);
+    buffer.push_back(mask[i]);
+  }
+  for (size_t i = 0; i < length; i++) {
+    buffer.push_back(payload[i] ^ mask[i & 3]);
+  }
+  return write(&_client, buffer.data(), buffer.size()) == buffer.size();
+}
+
+void DeflateWebSocketsClient::messageReceived(WSclient_t* client,
+                                              WSopcode_t opcode,
+                                              uint8_t* payload, size_t length,
+                                              bool fin) {
+  if (!client->cWsHeaderDecode.rsv1) {
+    WebSocketsClient::messageReceived(client, opcode, payload, length, fin);
+    return;
+  }
+  if (!fin) {
+    // deltas from the server are small; they are not worth the memory
+    // needed for reassembling fragmented compressed messages
+    debugW("Dropping fragmented compressed message");
+    return;
+  }
+  buffer.clear();
+  if (!inflate_message(payload, length, buffer, WS_INFLATE_MAX_LENGTH)) {
+    debugW("Dropping compressed message that could not be inflated");
+    return;
+  }
+  size_t inflated_length = buffer.size();
+  // text payloads are passed on null-terminated
+  buffer.push_back(0);
+  WebSocketsClient::messageReceived(client, opcode, buffer.data(),
+                                    inflated_length, fin);
+}
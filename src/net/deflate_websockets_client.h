@@ -0,0 +1,56 @@
+#ifndef _deflate_websockets_client_H_
+#define _deflate_websockets_client_H_
+
+#include <vector>
+
+#include <WebSocketsClient.h>
+
+// Base-2 logarithm of the LZ77 window used for outgoing messages
+#ifndef WS_DEFLATE_WINDOW_BITS
+#define WS_DEFLATE_WINDOW_BITS 10
+#endif
+
+// Largest decompressed message (bytes) accepted from the server
+#ifndef WS_INFLATE_MAX_LENGTH
+#define WS_INFLATE_MAX_LENGTH 8192
+#endif
+
+/**
+ * DeflateWebSocketsClient adds the permessage-deflate extension
+ * (RFC 7692) to WebSocketsClient. Both directions are negotiated
+ * without context takeover: every message is compressed on its own, so
+ * no compression state is kept between messages and the same
+ * compressed message can be sent to several servers.
+ *
+ * Compressed text messages from the server are inflated before they
+ * reach the event callback, where they show up as ordinary
+ * WStype_TEXT events.
+ */
+class DeflateWebSocketsClient : public WebSocketsClient {
+ public:
+  /**
+   * Selects whether permessage-deflate is offered in the handshake.
+   * Must be called after begin().
+   */
+  void set_compression(bool enabled);
+
+  /// Returns true if the server accepted permessage-deflate
+  bool compression_accepted();
+
+  /**
+   * Sends a text message that was compressed with a DeflateEncoder
+   * using at most WS_DEFLATE_WINDOW_BITS.
+   */
+  bool send_compressed_txt(const std::vector<uint8_t>& payload);
+
+ protected:
+  void messageReceived(WSclient_t* client, WSopcode_t opcode,
+                       uint8_t* payload, size_t length, bool fin) override;
+
+ private:
+  bool compression_requested = false;
+  // reused for outgoing frames and inflated messages
+  std::vector<uint8_t> buffer;
+};
+
+#endif
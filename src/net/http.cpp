@@ -1,11 +1,10 @@
 #include "http.h"
 
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include <FS.h>
-#ifdef ESP32
-#include "SPIFFS.h"
-#endif
 
 #include "Arduino.h"
 #include "AsyncJson.h"
@@ -13,7 +12,9 @@
 #include <ESPAsyncWebServer.h>
 
 #include "sensesp_app.h"
+#include "system/config_store.h"
 #include "system/configurable.h"
+#include "system/live_values.h"
 
 // Include the web UI stored in PROGMEM space
 #include "web/index.h"
@@ -26,6 +27,17 @@
 #define HTTP_SERVER_PORT 80
 #endif
 
+// Schemas are addressed by an ID derived from their content, so they can
+// be cached indefinitely
+#ifndef HTTP_SCHEMA_CACHE_CONTROL
+#define HTTP_SCHEMA_CACHE_CONTROL "public, max-age=31536000, immutable"
+#endif
+
+// Largest configuration accepted by PUT /config/_all
+#ifndef HTTP_CONFIG_IMPORT_MAX_LENGTH
+#define HTTP_CONFIG_IMPORT_MAX_LENGTH 16384
+#endif
+
 HTTPServer::HTTPServer(std::function<void()> reset_device) {
   this->reset_device = reset_device;
   server = new AsyncWebServer(HTTP_SERVER_PORT);
@@ -33,6 +45,21 @@ HTTPServer::HTTPServer(std::function<void()> reset_device) {
 
   server->onNotFound(std::bind(&HTTPServer::handle_not_found, this, _1));
 
+  // Handle exporting and importing the configuration of all Configurables
+  // at once. These must be registered before the handlers of /config,
+  // which would match the URL as well.
+  server->on("/config/_all", HTTP_GET,
+             std::bind(&HTTPServer::handle_config_export, this, _1));
+  AsyncCallbackJsonWebHandler* config_import_handler
+    = new AsyncCallbackJsonWebHandler(
+      "/config/_all",
+      [this](AsyncWebServerRequest *request, JsonVariant &json) {
+        this->handle_config_import(request, json);
+      });
+  config_import_handler->setMethod(HTTP_PUT);
+  config_import_handler->setMaxContentLength(HTTP_CONFIG_IMPORT_MAX_LENGTH);
+  server->addHandler(config_import_handler);
+
   // Handle setting configuration values of a Configurable via a Json PUT to /config
   AsyncCallbackJsonWebHandler* config_put_handler
     = new AsyncCallbackJsonWebHandler(
@@ -47,14 +74,12 @@ HTTPServer::HTTPServer(std::function<void()> reset_device) {
           return;
         }
 
-        std::map<String, Configurable*>::iterator it
-            = configurables.find(url_tail);
-        if (it==configurables.end()) {
+        Configurable* confable = configurables.find(url_tail.c_str());
+        if (confable==nullptr) {
           request->send(404, "text/plain",
                         F("Configuration key not found.\n"));
           return;
         }
-        Configurable* confable = it->second;
 
         JsonObject& body = json.as<JsonObject>();
         if (body.success()) {
@@ -86,24 +111,40 @@ HTTPServer::HTTPServer(std::function<void()> reset_device) {
       return;
     }
 
-    std::map<String, Configurable*>::iterator it
-        = configurables.find(url_tail);
-    if (it==configurables.end()) {
+    Configurable* confable = configurables.find(url_tail.c_str());
+    if (confable==nullptr) {
       request->send(404, "text/plain",
                     F("Configuration key not found.\n"));
       return;
     }
-    Configurable* confable = it->second;
 
     AsyncResponseStream *response = request->beginResponseStream("application/json");
     DynamicJsonBuffer json_buffer;
     JsonObject& root = json_buffer.createObject();
     root["config"] = confable->get_configuration(json_buffer);
-    root["schema"] = RawJson(confable->get_config_schema());
+    // the schema is fetched separately from /schema/<schema_id>
+    char schema_id[9];
+    snprintf(schema_id, sizeof(schema_id), "%08lx",
+             (unsigned long)confable->get_config_schema_id());
+    root["schema_id"] = schema_id;
     root.printTo(*response);
     request->send(response);
   });
 
+  // Stream the current values of the producers over a WebSocket. This
+  // must be registered before the handler of /values, which would match
+  // the URL as well.
+  live_value_stream = new LiveValueStream(server);
+
+  // Handle requests to retrieve the current values of the producers via
+  // HTTP GET on /values
+  server->on("/values", HTTP_GET,
+             std::bind(&HTTPServer::handle_values, this, _1));
+
+  // Handle requests to retrieve a config schema via HTTP GET on /schema
+  server->on("/schema", HTTP_GET,
+             std::bind(&HTTPServer::handle_schema, this, _1));
+
 
   server->on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
       debugD("Serving index.html");
@@ -196,13 +237,164 @@ void HTTPServer::handle_config_list(AsyncWebServerRequest* request) {
   DynamicJsonBuffer json_buffer;
   JsonObject& root = json_buffer.createObject();
   JsonArray& arr = root.createNestedArray("keys");
-  for (auto it = configurables.begin(); it!=configurables.end(); ++it) {
-    arr.add(it->first);
+  // list only a sub-tree, e.g. /config?prefix=/sensors/
+  String prefix;
+  if (request->hasParam("prefix")) {
+    prefix = request->getParam("prefix")->value();
   }
+  configurables.for_each(prefix.c_str(), [&arr](Configurable* confable) {
+    // the path is stored in the Configurable; no need to copy it
+    arr.add(confable->config_path.c_str());
+  });
   root.printTo(*response);
   request->send(response);
 }
 
+void HTTPServer::handle_values(AsyncWebServerRequest* request) {
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  DynamicJsonBuffer json_buffer;
+  JsonObject& root = json_buffer.createObject();
+  // read only a sub-tree, e.g. /values?prefix=/sensors/
+  String prefix;
+  if (request->hasParam("prefix")) {
+    prefix = request->getParam("prefix")->value();
+  }
+  live_values.get_values(prefix.c_str(), root);
+  root.printTo(*response);
+  request->send(response);
+}
+
+void HTTPServer::handle_schema(AsyncWebServerRequest* request) {
+  // omit the "/schema/" part of the url
+  String id_str = request->url().substring(8);
+  char* end;
+  uint32_t id = strtoul(id_str.c_str(), &end, 16);
+  if (id_str.length() != 8 || *end != 0) {
+    request->send(404, "text/plain", F("Schema not found.\n"));
+    return;
+  }
+  String etag = "\"" + id_str + "\"";
+  if (request->hasHeader("If-None-Match") &&
+      request->getHeader("If-None-Match")->value() == etag) {
+    AsyncWebServerResponse* response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", HTTP_SCHEMA_CACHE_CONTROL);
+    request->send(response);
+    return;
+  }
+  // any Configurable with this schema will do
+  Configurable* found = nullptr;
+  configurables.for_each("", [id, &found](Configurable* confable) {
+    if (found == nullptr && confable->get_config_schema_id() == id) {
+      found = confable;
+    }
+  });
+  if (found == nullptr) {
+    request->send(404, "text/plain", F("Schema not found.\n"));
+    return;
+  }
+  AsyncWebServerResponse* response;
+  PGM_P schema = found->get_config_schema_P();
+  if (schema != nullptr) {
+    response = request->beginResponse_P(200, "application/json", schema);
+  } else {
+    response = request->beginResponse(
+      200, "application/json", found->get_config_schema());
+  }
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", HTTP_SCHEMA_CACHE_CONTROL);
+  request->send(response);
+}
+
+void HTTPServer::handle_config_export(AsyncWebServerRequest* request) {
+  // Only the configuration of one Configurable is held in RAM at a
+  // time; the response is sent in chunks as it is generated.
+  struct ExportState {
+    size_t next = 0;
+    String pending = "{";
+    size_t offset = 0;
+    bool done = false;
+  };
+  auto state = std::make_shared<ExportState>();
+  AsyncWebServerResponse* response = request->beginChunkedResponse(
+    "application/json",
+    [state](uint8_t* buffer, size_t max_len, size_t index) -> size_t {
+      size_t len = 0;
+      while (len < max_len) {
+        if (state->offset == state->pending.length()) {
+          if (state->done) {
+            break;
+          }
+          state->offset = 0;
+          if (state->next == configurables.size()) {
+            state->pending = "}";
+            state->done = true;
+            continue;
+          }
+          Configurable* confable = configurables.at(state->next);
+          DynamicJsonBuffer json_buffer;
+          JsonObject& config = confable->get_configuration(json_buffer);
+          state->pending = state->next > 0 ? ",\"" : "\"";
+          state->pending += confable->config_path;
+          state->pending += "\":";
+          config.printTo(state->pending);
+          state->next++;
+        }
+        size_t chunk = min(max_len - len,
+                           state->pending.length() - state->offset);
+        memcpy(buffer + len, state->pending.c_str() + state->offset, chunk);
+        state->offset += chunk;
+        len += chunk;
+      }
+      return len;
+    });
+  request->send(response);
+}
+
+void HTTPServer::handle_config_import(AsyncWebServerRequest* request,
+                                      JsonVariant& json) {
+  JsonObject& body = json.as<JsonObject>();
+  if (!body.success()) {
+    request->send(400, "text/plain", F("Unable to parse JSON body.\n"));
+    return;
+  }
+  // check all the keys before changing anything
+  for (auto kv : body) {
+    if (configurables.find(kv.key) == nullptr ||
+        !kv.value.is<JsonObject>()) {
+      request->send(404, "text/plain",
+                    String(F("Configuration key not found: ")) + kv.key +
+                    "\n");
+      return;
+    }
+  }
+  // Keep the previous configuration of the Configurables changed so far,
+  // to restore them if one of them refuses its new configuration
+  std::vector<std::pair<Configurable*, String>> previous;
+  for (auto kv : body) {
+    Configurable* confable = configurables.find(kv.key);
+    DynamicJsonBuffer json_buffer;
+    String config;
+    confable->get_configuration(json_buffer).printTo(config);
+    previous.push_back({confable, config});
+    if (!confable->set_configuration(kv.value.as<JsonObject>())) {
+      for (auto& prev : previous) {
+        DynamicJsonBuffer prev_buffer;
+        prev.first->set_configuration(prev_buffer.parseObject(prev.second));
+      }
+      request->send(400, "text/plain",
+                    String(F("Unable to extract keys from JSON for ")) +
+                    kv.key + "\n");
+      return;
+    }
+  }
+  // the config store writes all of them at once
+  for (auto& prev : previous) {
+    prev.first->save_configuration();
+  }
+  request->send(200, "text/plain", F("Configuration successful.\n"));
+}
+
 void HTTPServer::handle_config(AsyncWebServerRequest* request) {
   debugD("%s", request->url().c_str());
   request->send(200, "text/plain", "/config");
@@ -216,7 +408,10 @@ void HTTPServer::handle_device_reset(AsyncWebServerRequest* request) {
 
 void HTTPServer::handle_device_restart(AsyncWebServerRequest* request) {
   request->send(200, "text/plain", "OK, restarting\n");
-  app.onDelay(50, [](){ ESP.restart(); });
+  app.onDelay(50, [](){
+    config_store.flush();
+    ESP.restart();
+  });
 }
 
 
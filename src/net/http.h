@@ -3,13 +3,22 @@
 
 #include <functional>
 
+#include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
 
+#include "net/live_value_stream.h"
+
 class HTTPServer {
  public:
   HTTPServer(std::function<void()> reset_device);
-  ~HTTPServer() { delete server; }
-  void enable() { server->begin(); }
+  ~HTTPServer() {
+    delete live_value_stream;
+    delete server;
+  }
+  void enable() {
+    server->begin();
+    live_value_stream->enable();
+  }
   void handle_not_found(AsyncWebServerRequest* request);
   void handle_config(AsyncWebServerRequest* request);
   void handle_device_reset(AsyncWebServerRequest* request);
@@ -17,8 +26,13 @@ class HTTPServer {
   void handle_info(AsyncWebServerRequest* request);
  private:
   AsyncWebServer* server;
+  LiveValueStream* live_value_stream;
   std::function<void()> reset_device;
   void handle_config_list(AsyncWebServerRequest* request);
+  void handle_values(AsyncWebServerRequest* request);
+  void handle_schema(AsyncWebServerRequest* request);
+  void handle_config_export(AsyncWebServerRequest* request);
+  void handle_config_import(AsyncWebServerRequest* request, JsonVariant& json);
 };
 
 
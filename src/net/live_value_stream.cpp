@@ -0,0 +1,238 @@
+#include "live_value_stream.h"
+
+#include <algorithm>
+
+#include <ArduinoJson.h>
+
+#include "sensesp.h"
+#include "system/live_values.h"
+
+LiveValueStream::LiveValueStream(AsyncWebServer* server) {
+  ws.onEvent([this](AsyncWebSocket* ws, AsyncWebSocketClient* client,
+                    AwsEventType type, void* arg, uint8_t* data, size_t len) {
+    this->handle_event(client, type, arg, data, len);
+  });
+  server->addHandler(&ws);
+}
+
+void LiveValueStream::enable() {
+  app.onRepeat(LIVE_VALUE_STREAM_MIN_INTERVAL,
+               [this]() { this->send_updates(); });
+}
+
+void LiveValueStream::handle_event(AsyncWebSocketClient* client,
+                                   AwsEventType type, void* arg,
+                                   uint8_t* data, size_t len) {
+  switch (type) {
+    case WS_EVT_CONNECT:
+      if (ws.count() > LIVE_VALUE_STREAM_MAX_CLIENTS) {
+        debugW("Too many live value clients");
+        client->close();
+      }
+      break;
+    case WS_EVT_DISCONNECT:
+      queue_event(client->id(), true, "");
+      break;
+    case WS_EVT_DATA: {
+      AwsFrameInfo* info = (AwsFrameInfo*)arg;
+      // subscriptions are short; ignore fragmented messages
+      if (!info->final || info->index != 0 || info->len != len ||
+          info->opcode != WS_TEXT) {
+        break;
+      }
+      String message;
+      message.reserve(len);
+      for (size_t i = 0; i < len; i++) {
+        message += (char)data[i];
+      }
+      queue_event(client->id(), false, message);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void LiveValueStream::queue_event(uint32_t client_id, bool disconnect,
+                                  String message) {
+  TaskLock lock(events_mutex);
+  // only the last subscription of a client counts
+  events.erase(std::remove_if(events.begin(), events.end(),
+                              [client_id](const Event& event) {
+                                return event.client_id == client_id;
+                              }),
+               events.end());
+  events.push_back({client_id, disconnect, message});
+}
+
+void LiveValueStream::apply_events() {
+  std::vector<Event> received;
+  {
+    TaskLock lock(events_mutex);
+    received.swap(events);
+  }
+  for (auto& event : received) {
+    AsyncWebSocketClient* client =
+        event.disconnect ? nullptr : ws.client(event.client_id);
+    if (client == nullptr) {
+      // disconnected, possibly before the subscription was applied
+      unsubscribe(event.client_id);
+    } else {
+      subscribe(client, event.message.c_str());
+    }
+  }
+}
+
+void LiveValueStream::subscribe(AsyncWebSocketClient* client,
+                                const char* message) {
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& root = jsonBuffer.parseObject(message);
+  if (!root.success() || !root["subscribe"].is<JsonArray>()) {
+    debugW("Invalid live value subscription");
+    return;
+  }
+  unsubscribe(client->id());
+
+  std::vector<String> prefixes;
+  for (auto prefix : root["subscribe"].as<JsonArray>()) {
+    prefixes.push_back(prefix.as<String>());
+  }
+  if (prefixes.empty()) {
+    return;
+  }
+  // the same prefixes in another order are the same subscription
+  std::sort(prefixes.begin(), prefixes.end());
+  uint32_t requested = root.containsKey("interval")
+                           ? root["interval"].as<unsigned int>()
+                           : 1000;
+  uint32_t interval = LIVE_VALUE_STREAM_MIN_INTERVAL;
+  while (interval < requested && interval < LIVE_VALUE_STREAM_MAX_INTERVAL) {
+    interval *= 2;
+  }
+
+  String key = String(interval);
+  for (auto& prefix : prefixes) {
+    key += "\n" + prefix;
+  }
+  live_values.track_changes();
+  Group& group = groups[key];
+  if (group.clients.empty()) {
+    group.interval = interval;
+    group.prefixes = prefixes;
+    group.last_time = millis();
+    group.last_sequence = live_values.get_sequence();
+  }
+  group.clients.push_back(client->id());
+  subscriptions[client->id()] = key;
+
+  // start with all the subscribed values
+  send_all(client, group);
+}
+
+void LiveValueStream::send_all(AsyncWebSocketClient* client,
+                               const Group& group) {
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& values = jsonBuffer.createObject();
+  for (auto& prefix : group.prefixes) {
+    live_values.get_values(prefix.c_str(), values);
+  }
+  String json;
+  values.printTo(json);
+  client->text(json);
+}
+
+void LiveValueStream::unsubscribe(uint32_t client_id) {
+  auto it = subscriptions.find(client_id);
+  if (it == subscriptions.end()) {
+    return;
+  }
+  auto group_it = groups.find(it->second);
+  subscriptions.erase(it);
+  lagging.erase(client_id);
+  if (group_it == groups.end()) {
+    return;
+  }
+  auto& clients = group_it->second.clients;
+  clients.erase(std::remove(clients.begin(), clients.end(), client_id),
+                clients.end());
+  if (clients.empty()) {
+    groups.erase(group_it);
+  }
+}
+
+void LiveValueStream::free_buffers() {
+  // a buffer is locked by each message that still holds it
+  for (auto it = buffers.begin(); it != buffers.end();) {
+    if ((*it)->canDelete()) {
+      delete *it;
+      it = buffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void LiveValueStream::send_updates() {
+  apply_events();
+  free_buffers();
+  ws.cleanupClients(LIVE_VALUE_STREAM_MAX_CLIENTS);
+
+  // clients that missed updates get all their values once they catch up
+  for (auto it = lagging.begin(); it != lagging.end();) {
+    AsyncWebSocketClient* client = ws.client(*it);
+    if (client != nullptr && !client->canSend()) {
+      ++it;
+      continue;
+    }
+    auto subscription = subscriptions.find(*it);
+    if (client != nullptr && subscription != subscriptions.end()) {
+      send_all(client, groups[subscription->second]);
+    }
+    it = lagging.erase(it);
+  }
+
+  uint32_t now = millis();
+  uint32_t sequence = live_values.get_sequence();
+  for (auto& kv : groups) {
+    Group& group = kv.second;
+    if (group.last_sequence == sequence ||
+        now - group.last_time < group.interval) {
+      continue;
+    }
+    DynamicJsonBuffer jsonBuffer;
+    JsonObject& root = jsonBuffer.createObject();
+    size_t count = 0;
+    for (auto& prefix : group.prefixes) {
+      count += live_values.get_changed_values(prefix.c_str(), root,
+                                              group.last_sequence);
+    }
+    group.last_time = now;
+    group.last_sequence = sequence;
+    if (count == 0) {
+      continue;
+    }
+    size_t length = root.measureLength();
+    // not made by ws.makeBuffer(), which would keep it until the next
+    // textAll()
+    auto* buffer = new AsyncWebSocketMessageBuffer(length);
+    if (buffer->get() == nullptr) {
+      delete buffer;
+      continue;
+    }
+    buffers.push_back(buffer);
+    root.printTo((char*)buffer->get(), length + 1);
+    for (auto id : group.clients) {
+      AsyncWebSocketClient* client = ws.client(id);
+      if (client == nullptr || lagging.count(id) > 0) {
+        continue;
+      }
+      // a client that can't keep up skips updates instead of queueing
+      // them
+      if (client->canSend()) {
+        client->text(buffer);
+      } else {
+        lagging.insert(id);
+      }
+    }
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef _live_value_stream_H_
+#define _live_value_stream_H_
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Arduino.h"
+#include <ESPAsyncWebServer.h>
+
+#include "system/task_lock.h"
+
+// URL of the WebSocket streaming the live values
+#ifndef LIVE_VALUE_STREAM_PATH
+#define LIVE_VALUE_STREAM_PATH "/values/stream"
+#endif
+
+// Shortest interval (ms) between updates. Requested intervals are
+// rounded up to this interval times a power of two.
+#ifndef LIVE_VALUE_STREAM_MIN_INTERVAL
+#define LIVE_VALUE_STREAM_MIN_INTERVAL 100
+#endif
+
+#ifndef LIVE_VALUE_STREAM_MAX_INTERVAL
+#define LIVE_VALUE_STREAM_MAX_INTERVAL 12800
+#endif
+
+// Each client takes a TCP connection and a send queue
+#ifndef LIVE_VALUE_STREAM_MAX_CLIENTS
+#define LIVE_VALUE_STREAM_MAX_CLIENTS 4
+#endif
+
+/**
+ * LiveValueStream pushes the values of the LiveValueRegistry to web
+ * browsers over a WebSocket, so that they don't need to poll.
+ *
+ * A client subscribes by sending
+ * {"subscribe": ["/sensors/", "/gauge/curve"], "interval": 500}
+ * where each entry of "subscribe" is an ID prefix as in GET /values,
+ * and "interval" is the shortest time (ms) between two updates. It then
+ * gets all the subscribed values at once, followed by the values that
+ * have changed, as a JSON object of IDs and values, at most once per
+ * interval.
+ *
+ * Clients with the same subscription and interval share an update: it
+ * is serialized once and the same buffer is queued to each of them.
+ * Rounding the intervals makes such sharing more likely.
+ *
+ * Subscriptions and disconnects arrive in the web server's callbacks.
+ * They are queued and applied from the main loop, which owns all other
+ * state, before the updates are sent.
+ */
+class LiveValueStream {
+ public:
+  LiveValueStream(AsyncWebServer* server);
+  void enable();
+
+ private:
+  struct Group {
+    uint32_t interval;
+    std::vector<String> prefixes;
+    std::vector<uint32_t> clients;
+    uint32_t last_time = 0;
+    // sequence number of the live values at the last update
+    uint32_t last_sequence = 0;
+  };
+
+  AsyncWebSocket ws{LIVE_VALUE_STREAM_PATH};
+  // groups by their interval and prefixes
+  std::map<String, Group> groups;
+  // the group key of each client
+  std::map<uint32_t, String> subscriptions;
+  // clients that have skipped an update
+  std::set<uint32_t> lagging;
+
+  // a subscription or disconnect, not yet applied
+  struct Event {
+    uint32_t client_id;
+    bool disconnect;
+    String message;
+  };
+  // shared with the web server's callbacks; only accessed under the lock
+  TaskMutex events_mutex;
+  std::vector<Event> events;
+  // updates queued to clients, deleted once no client holds them
+  std::vector<AsyncWebSocketMessageBuffer*> buffers;
+
+  void handle_event(AsyncWebSocketClient* client, AwsEventType type,
+                    void* arg, uint8_t* data, size_t len);
+  void queue_event(uint32_t client_id, bool disconnect, String message);
+  void apply_events();
+  void subscribe(AsyncWebSocketClient* client, const char* message);
+  void unsubscribe(uint32_t client_id);
+  void send_all(AsyncWebSocketClient* client, const Group& group);
+  void free_buffers();
+  void send_updates();
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "networking.h"
 
 #include "sensesp.h"
+#include "system/config_store.h"
 #include "system/led_blinker.h"
 
 // Wifi config portal timeout (seconds). The smaller the value, the faster
@@ -30,6 +31,7 @@ void Networking::check_connection() {
   if (WiFi.status() != WL_CONNECTED) {
     // if connection is lost, simply restart
     debugD("Wifi disconnected: restarting...");
+    config_store.flush();
     ESP.restart();
   }
 }
@@ -101,7 +103,10 @@ void Networking::setup_wifi_manager(std::function<void(bool)> connection_cb) {
     this->ap_password = WiFi.psk();
     save_configuration();
     debugW("Restarting in 500ms");
-    app.onDelay(500, [](){ ESP.restart(); });
+    app.onDelay(500, [](){
+      config_store.flush();
+      ESP.restart();
+    });
   }
 }
 
@@ -124,8 +129,8 @@ static const char SCHEMA[] PROGMEM = R"({
     }
   })";
 
-String Networking::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Networking::get_config_schema_P() {
+  return SCHEMA;
 }
 
 JsonObject& Networking::get_configuration(JsonBuffer& buf) {
@@ -17,7 +17,7 @@ class Networking : public Configurable {
   ObservableValue<String>* get_hostname();
   virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
   virtual bool set_configuration(const JsonObject& config) override final;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
   //void set_hostname(String hostname);
 
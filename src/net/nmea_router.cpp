@@ -0,0 +1,194 @@
+#include "nmea_router.h"
+
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+
+#include "sensesp.h"
+
+void NMEAPort::count_written(size_t length, bool written) {
+  if (written) {
+    stats.chars_out += length;
+    stats.sentences_out++;
+  } else {
+    stats.sentences_dropped++;
+  }
+}
+
+void NMEAPort::read_stream(Stream* stream) {
+  char buf[NMEA_PORT_READ_CHUNK_SIZE];
+  int available;
+  while ((available = stream->available()) > 0) {
+    size_t len = stream->readBytes(buf, min(available, (int)sizeof(buf)));
+    if (len == 0) {
+      break;
+    }
+    this->handle(buf, len);
+  }
+}
+
+bool NMEAStreamPort::write(const char* sentence, size_t length) {
+  bool written = stream->write((const uint8_t*)sentence, length) == length;
+  count_written(length, written);
+  return written;
+}
+
+void NMEAStreamPort::enable() {
+  app.onAvailable(*stream, [this]() { this->read_stream(stream); });
+}
+
+bool NMEATCPServerPort::write(const char* sentence, size_t length) {
+  bool written = false;
+  for (auto& client : clients) {
+    if (!client.connected()) {
+      continue;
+    }
+    bool client_written =
+        client.write((const uint8_t*)sentence, length) == length;
+    count_written(length, client_written);
+    written |= client_written;
+  }
+  return written;
+}
+
+void NMEATCPServerPort::enable() {
+  server.begin();
+  server.setNoDelay(true);
+  app.onRepeat(NMEA_TCP_POLL_INTERVAL, [this]() { this->poll(); });
+}
+
+void NMEATCPServerPort::poll() {
+  while (server.hasClient()) {
+    WiFiClient* free_slot = nullptr;
+    for (auto& client : clients) {
+      if (!client.connected()) {
+        free_slot = &client;
+        break;
+      }
+    }
+    WiFiClient new_client = server.available();
+    if (free_slot == nullptr) {
+      debugW("%s: too many clients", name.c_str());
+      new_client.stop();
+      continue;
+    }
+    free_slot->stop();
+    *free_slot = new_client;
+    debugI("%s: client connected", name.c_str());
+  }
+  for (auto& client : clients) {
+    if (client.connected()) {
+      read_stream(&client);
+    }
+  }
+}
+
+bool NMEATCPClientPort::write(const char* sentence, size_t length) {
+  bool written = client.connected() &&
+                 client.write((const uint8_t*)sentence, length) == length;
+  count_written(length, written);
+  return written;
+}
+
+void NMEATCPClientPort::enable() {
+  app.onRepeat(NMEA_TCP_POLL_INTERVAL, [this]() { this->poll(); });
+}
+
+void NMEATCPClientPort::poll() {
+  if (client.connected()) {
+    read_stream(&client);
+    return;
+  }
+  uint32_t now = millis();
+  if (attempted && now - last_attempt < NMEA_TCP_RECONNECT_INTERVAL) {
+    return;
+  }
+  attempted = true;
+  last_attempt = now;
+  if (WiFi.status() != WL_CONNECTED) {
+    return;
+  }
+  debugI("%s: connecting to %s:%d", name.c_str(), host.c_str(), port);
+  client.connect(host.c_str(), port);
+}
+
+void NMEARouter::add_port(NMEAPort* port) {
+  ports.push_back(port);
+  port->parser.set_sentence_forwarder(
+      [this, port](const char* sentence, size_t length) {
+        this->forward(port, sentence, length);
+      });
+}
+
+void NMEARouter::add_route(NMEAPort* from, NMEAPort* to,
+                           const String& talkers, const String& sentences) {
+  Route route = {from, to};
+  for (const char* p = talkers.c_str(); *p != 0;) {
+    while (*p == ',' || *p == ' ') {
+      p++;
+    }
+    if (p[0] == 0 || p[1] == 0) {
+      break;
+    }
+    route.talkers.push_back(p[0] << 8 | p[1]);
+    p += 2;
+  }
+  for (const char* p = sentences.c_str(); *p != 0;) {
+    while (*p == ',' || *p == ' ') {
+      p++;
+    }
+    uint32_t key = pack_sentence_key(p, false);
+    if (key != 0) {
+      route.sentences.push_back(key);
+    }
+    while (*p != 0 && *p != ',') {
+      p++;
+    }
+  }
+  routes.push_back(route);
+}
+
+void NMEARouter::enable() {
+  for (auto* port : ports) {
+    port->enable();
+  }
+}
+
+void NMEARouter::forward(NMEAPort* from, const char* sentence,
+                         size_t length) {
+  from->stats.sentences_in++;
+  // skip the '$' or '!'
+  const char* address = sentence + 1;
+  uint16_t talker = address[0] << 8 | address[1];
+  uint32_t key = 0;
+  for (auto& route : routes) {
+    if (route.from != from) {
+      continue;
+    }
+    // proprietary sentences have no talker
+    if (!route.talkers.empty() && address[0] != 'P') {
+      bool match = false;
+      for (uint16_t t : route.talkers) {
+        match |= t == talker;
+      }
+      if (!match) {
+        continue;
+      }
+    }
+    if (!route.sentences.empty()) {
+      if (key == 0) {
+        key = pack_sentence_key(address, true);
+      }
+      bool match = false;
+      for (uint32_t k : route.sentences) {
+        match |= k == key;
+      }
+      if (!match) {
+        continue;
+      }
+    }
+    route.to->write(sentence, length);
+  }
+}
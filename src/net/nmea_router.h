@@ -0,0 +1,166 @@
+#ifndef _nmea_router_H_
+#define _nmea_router_H_
+
+#include <vector>
+
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+
+#include "Arduino.h"
+#include "system/nmea_parser.h"
+
+// Clients that can be connected to an NMEATCPServerPort at the same time
+#ifndef NMEA_TCP_MAX_CLIENTS
+#define NMEA_TCP_MAX_CLIENTS 4
+#endif
+
+// Interval (ms) at which the TCP ports are polled for connections and data
+#ifndef NMEA_TCP_POLL_INTERVAL
+#define NMEA_TCP_POLL_INTERVAL 20
+#endif
+
+// Interval (ms) between connection attempts of an NMEATCPClientPort
+#ifndef NMEA_TCP_RECONNECT_INTERVAL
+#define NMEA_TCP_RECONNECT_INTERVAL 5000
+#endif
+
+// Number of characters read from a port at a time
+#ifndef NMEA_PORT_READ_CHUNK_SIZE
+#define NMEA_PORT_READ_CHUNK_SIZE 64
+#endif
+
+/// Throughput of one NMEAPort since boot
+struct NMEAPortStats {
+  uint32_t chars_in;
+  // sentences received with a valid checksum
+  uint32_t sentences_in;
+  uint32_t chars_out;
+  uint32_t sentences_out;
+  // sentences that could not be written, e.g. to a slow TCP client
+  uint32_t sentences_dropped;
+};
+
+/**
+ * An NMEA 0183 source and/or destination for the NMEARouter. Every port
+ * has a parser of its own, so that the sentences of different sources
+ * are never mixed up. Sentence parsers can be added to it as usual to
+ * decode the data of the port.
+ */
+class NMEAPort {
+ public:
+  NMEAPort(const String& name) : name{name} {}
+  const String& get_name() { return name; }
+  NMEAParser* get_parser() { return &parser; }
+  const NMEAPortStats& get_stats() { return stats; }
+  /**
+   * Sends a complete sentence, including CR LF.
+   * @return false if the sentence was dropped
+   */
+  virtual bool write(const char* sentence, size_t length) = 0;
+  virtual void enable() = 0;
+
+ protected:
+  String name;
+  NMEAParser parser;
+  NMEAPortStats stats = {};
+
+  /// Passes received characters on to the parser
+  void handle(const char* data, size_t length) {
+    stats.chars_in += length;
+    parser.handle(data, length);
+  }
+  void count_written(size_t length, bool written);
+  /// Reads everything available from the stream
+  void read_stream(Stream* stream);
+
+  friend class NMEARouter;
+};
+
+/// A port on a serial interface or any other Stream
+class NMEAStreamPort : public NMEAPort {
+ public:
+  NMEAStreamPort(const String& name, Stream* stream)
+      : NMEAPort{name}, stream{stream} {}
+  bool write(const char* sentence, size_t length) override;
+  void enable() override;
+
+ private:
+  Stream* stream;
+};
+
+/**
+ * A TCP server that sends the routed sentences to every connected
+ * client, e.g. a navigation app. Sentences sent by the clients are
+ * received like on any other port.
+ */
+class NMEATCPServerPort : public NMEAPort {
+ public:
+  NMEATCPServerPort(const String& name, uint16_t port)
+      : NMEAPort{name}, server{port} {}
+  bool write(const char* sentence, size_t length) override;
+  void enable() override;
+
+ private:
+  WiFiServer server;
+  WiFiClient clients[NMEA_TCP_MAX_CLIENTS];
+  void poll();
+};
+
+/**
+ * A TCP client that receives sentences from a server, e.g. a WiFi NMEA
+ * gateway, and reconnects when the connection is lost.
+ */
+class NMEATCPClientPort : public NMEAPort {
+ public:
+  NMEATCPClientPort(const String& name, const String& host, uint16_t port)
+      : NMEAPort{name}, host{host}, port{port} {}
+  bool write(const char* sentence, size_t length) override;
+  void enable() override;
+
+ private:
+  String host;
+  uint16_t port;
+  WiFiClient client;
+  uint32_t last_attempt = 0;
+  bool attempted = false;
+  void poll();
+};
+
+/**
+ * NMEARouter forwards the sentences received on one NMEAPort to others.
+ * Sentences are forwarded exactly as received once their checksum has
+ * been validated; they are not parsed again for routing. Each route can
+ * be limited to certain talkers and sentences.
+ */
+class NMEARouter {
+ public:
+  void add_port(NMEAPort* port);
+  /**
+   * Forwards the sentences received on one port to another one.
+   * @param talkers Comma separated talker IDs, e.g. "GP,GN". An empty
+   *   string forwards all talkers.
+   * @param sentences Comma separated sentence formatters, e.g. "RMC,GGA",
+   *   or proprietary addresses, e.g. "PSTI". An empty string forwards
+   *   all sentences.
+   */
+  void add_route(NMEAPort* from, NMEAPort* to, const String& talkers = "",
+                 const String& sentences = "");
+  /// Enables all ports
+  void enable();
+  const std::vector<NMEAPort*>& get_ports() { return ports; }
+
+ private:
+  struct Route {
+    NMEAPort* from;
+    NMEAPort* to;
+    // packed talker IDs and sentence keys; none means all
+    std::vector<uint16_t> talkers;
+    std::vector<uint32_t> sentences;
+  };
+  std::vector<NMEAPort*> ports;
+  std::vector<Route> routes;
+
+  void forward(NMEAPort* from, const char* sentence, size_t length);
+};
+
+#endif
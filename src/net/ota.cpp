@@ -4,6 +4,7 @@
 #include <ArduinoOTA.h>
 
 #include "sensesp.h"
+#include "system/config_store.h"
 
 // Password for Over-the-air (OTA) updates
 #ifndef OTA_PASSWORD
@@ -20,6 +21,8 @@ void setup_OTA() {
 #endif
   ArduinoOTA.onStart([]() {
     debugW("Starting OTA");
+    // the device restarts after the update
+    config_store.flush();
   });
   ArduinoOTA.onEnd([]() {
     debugW("OTA End");
@@ -0,0 +1,189 @@
+#include "server_discovery.h"
+
+#ifdef ESP8266
+#include <ESP8266mDNS.h>
+#elif defined(ESP32)
+#include <ESPmDNS.h>
+#endif
+
+#include "sensesp.h"
+
+ServerDiscovery::ServerDiscovery(const char* service, const char* protocol,
+                                 uint32_t ttl)
+    : service{service}, protocol{protocol}, ttl{ttl} {}
+
+void ServerDiscovery::enable() {
+#ifdef ESP8266
+  // LEAmDNS keeps a continuous query running and reports the answers
+  // as they arrive, so the cache stays fresh without ever blocking.
+  MDNS.installServiceQuery(
+      service, protocol,
+      [this](MDNSResponder::MDNSServiceInfo info,
+             MDNSResponder::AnswerType answer_type, bool set_content) {
+        if (!info.IP4AddressAvailable() || !info.hostPortAvailable()) {
+          return;
+        }
+        String address = info.IP4Adresses()[0].toString();
+        uint16_t port = info.hostPort();
+        if (set_content) {
+          debugD("mDNS announced %s:%d", address.c_str(), port);
+          this->update(address, port, true);
+        } else {
+          debugD("mDNS answer for %s:%d expired", address.c_str(), port);
+          this->expire(address, port);
+        }
+      });
+#else
+  // ESPmDNS only has blocking queries, and a query stalls all the
+  // reactions for seconds. Rather than re-querying periodically, the
+  // cache is refreshed by get_endpoint(), only when a connection is
+  // about to be made and no fresh server is cached.
+#endif
+}
+
+bool ServerDiscovery::get_endpoint(String& address, uint16_t& port) {
+  int i = -1;
+  if (preferred >= 0 && !preferred_failed &&
+      endpoints[preferred].clients == 0) {
+    i = preferred;
+  } else {
+    i = select_fresh(false);
+    if (i < 0) {
+      this->refresh();
+      i = select_fresh(false);
+    }
+    if (i < 0 && share_servers) {
+      i = select_fresh(true);
+    }
+    if (i < 0) {
+      // nothing else is known; keep retrying the old server
+      i = preferred;
+    }
+  }
+  if (i < 0 || (!share_servers && endpoints[i].clients > 0)) {
+    // every known server already has a client; stay idle
+    return false;
+  }
+  address = endpoints[i].address;
+  port = endpoints[i].port;
+  return true;
+}
+
+void ServerDiscovery::set_preferred(const String& address, uint16_t port) {
+  if (address.length() == 0 || port == 0) {
+    return;
+  }
+  int i = update(address, port, false);
+  if (i >= 0) {
+    preferred = i;
+    preferred_failed = false;
+  }
+}
+
+void ServerDiscovery::report_success(const String& address, uint16_t port) {
+  int i = update(address, port, true);
+  if (i < 0) {
+    return;
+  }
+  preferred = i;
+  endpoints[i].failures = 0;
+  endpoints[i].clients++;
+  preferred_failed = false;
+}
+
+void ServerDiscovery::release(const String& address, uint16_t port) {
+  int i = find(address, port);
+  if (i >= 0 && endpoints[i].clients > 0) {
+    endpoints[i].clients--;
+  }
+}
+
+void ServerDiscovery::report_failure(const String& address, uint16_t port) {
+  int i = find(address, port);
+  if (i < 0) {
+    return;
+  }
+  endpoints[i].failures++;
+  if (i == preferred) {
+    preferred_failed = true;
+  }
+}
+
+void ServerDiscovery::refresh() {
+  debugD("Querying mDNS for %s.%s", service, protocol);
+  int n = MDNS.queryService(service, protocol);
+  for (int i = 0; i < n; i++) {
+    String address = MDNS.IP(i).toString();
+    uint16_t port = MDNS.port(i);
+    debugI("Found server %s (port %d)", address.c_str(), port);
+    update(address, port, true);
+  }
+}
+
+int ServerDiscovery::find(const String& address, uint16_t port) {
+  for (size_t i = 0; i < endpoints.size(); i++) {
+    if (endpoints[i].port == port && endpoints[i].address == address) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int ServerDiscovery::update(const String& address, uint16_t port,
+                            bool seen) {
+  int i = find(address, port);
+  if (i < 0) {
+    if (endpoints.size() < MAX_DISCOVERED_SERVERS) {
+      endpoints.push_back({address, port, 0, 0, 0});
+      i = endpoints.size() - 1;
+    } else {
+      // replace the endpoint that was seen longest ago. Slots are
+      // overwritten in place to keep the preferred index valid.
+      uint32_t now = millis();
+      uint32_t oldest_age = 0;
+      for (size_t j = 0; j < endpoints.size(); j++) {
+        uint32_t age = now - endpoints[j].last_seen;
+        if ((int)j != preferred && endpoints[j].clients == 0 &&
+            (i < 0 || age > oldest_age)) {
+          i = j;
+          oldest_age = age;
+        }
+      }
+      if (i < 0) {
+        // every slot is in use
+        return -1;
+      }
+      endpoints[i] = {address, port, 0, 0, 0};
+    }
+  }
+  if (seen) {
+    // 0 is reserved for "never seen"
+    endpoints[i].last_seen = millis() | 1;
+  }
+  return i;
+}
+
+void ServerDiscovery::expire(const String& address, uint16_t port) {
+  int i = find(address, port);
+  if (i >= 0) {
+    endpoints[i].last_seen = 0;
+  }
+}
+
+bool ServerDiscovery::is_fresh(const ServerEndpoint& endpoint) {
+  return endpoint.last_seen != 0 && millis() - endpoint.last_seen < ttl;
+}
+
+int ServerDiscovery::select_fresh(bool allow_claimed) {
+  int selected = -1;
+  for (size_t i = 0; i < endpoints.size(); i++) {
+    if (!is_fresh(endpoints[i]) ||
+        (!allow_claimed && endpoints[i].clients > 0)) {
+      continue;
+    }
+    if (selected < 0 || endpoints[i].failures < endpoints[selected].failures) {
+      selected = i;
+    }
+  }
+  return selected;
+}
@@ -0,0 +1,107 @@
+#ifndef _server_discovery_H_
+#define _server_discovery_H_
+
+#include <vector>
+
+#include "Arduino.h"
+
+// Number of servers remembered by a ServerDiscovery
+#ifndef MAX_DISCOVERED_SERVERS
+#define MAX_DISCOVERED_SERVERS 4
+#endif
+
+struct ServerEndpoint {
+  String address;
+  uint16_t port;
+  // millis() of the latest mDNS answer for this endpoint
+  uint32_t last_seen;
+  // consecutive failed connection attempts
+  uint16_t failures;
+  // number of clients currently connected to this endpoint
+  uint8_t clients;
+};
+
+/**
+ * ServerDiscovery keeps a cache of servers announcing an mDNS service.
+ * Cached entries expire after a TTL unless they are seen again. The
+ * cache is refreshed in the background on ESP8266, so picking a server
+ * for a connection attempt normally doesn't need a blocking mDNS query.
+ * On ESP32, which has no background queries, the cache is refreshed
+ * when a server is picked and none of the cached ones is fresh.
+ *
+ * The server that last accepted a connection is preferred. If it fails,
+ * the other discovered servers are tried in order of their failure count.
+ * When several clients share the cache, servers that already have a
+ * client connected are only handed out if no other server is available,
+ * and never if sharing servers is turned off.
+ */
+class ServerDiscovery {
+ public:
+  /**
+   * @param service The mDNS service name, e.g. "signalk-ws"
+   * @param protocol The mDNS protocol, e.g. "tcp"
+   * @param ttl Time (ms) after which an endpoint that hasn't been seen
+   *   again is no longer used
+   */
+  ServerDiscovery(const char* service, const char* protocol,
+                  uint32_t ttl = 10 * 60 * 1000);
+
+  /**
+   * Starts the background refresh, where supported. Must be called
+   * after the mDNS responder has been started.
+   */
+  void enable();
+
+  /**
+   * Picks the server for the next connection attempt. Only blocks on an
+   * mDNS query if no usable server is cached.
+   * @return false if no server could be found
+   */
+  bool get_endpoint(String& address, uint16_t& port);
+
+  /**
+   * Sets the server that is tried first, e.g. a server
+   * persisted from an earlier session.
+   */
+  void set_preferred(const String& address, uint16_t port);
+
+  /**
+   * Marks a server as working, makes it the preferred one and counts
+   * a connected client on it. Call release() when the client
+   * disconnects.
+   */
+  void report_success(const String& address, uint16_t port);
+
+  /// Removes a connected client from a server
+  void release(const String& address, uint16_t port);
+
+  /// Counts a failed connection attempt against a server
+  void report_failure(const String& address, uint16_t port);
+
+  /// Runs a blocking mDNS query and updates the cache with the answers
+  void refresh();
+
+  /**
+   * Sets whether a server that already has a client connected may be
+   * handed to another client. Clients that each send every delta must
+   * not share a server, or it receives the deltas twice.
+   */
+  void set_share_servers(bool share) { share_servers = share; }
+
+ private:
+  const char* service;
+  const char* protocol;
+  uint32_t ttl;
+  std::vector<ServerEndpoint> endpoints;
+  // index of the preferred endpoint, or -1
+  int preferred = -1;
+  bool preferred_failed = false;
+  bool share_servers = true;
+  int find(const String& address, uint16_t port);
+  int update(const String& address, uint16_t port, bool seen);
+  void expire(const String& address, uint16_t port);
+  bool is_fresh(const ServerEndpoint& endpoint);
+  int select_fresh(bool allow_claimed);
+};
+
+#endif
@@ -5,10 +5,8 @@
 #include <ArduinoJson.h>
 #ifdef ESP8266
 #include <ESP8266HTTPClient.h>
-#include <ESP8266mDNS.h>  // Include the mDNS library
 #elif defined(ESP32)
 #include <HTTPClient.h>
-#include <ESPmDNS.h>
 #endif
 
 #include <ESPTrueRandom.h>
@@ -17,79 +15,150 @@
 #include "sensesp_app.h"
 
 #include "signalk/signalk_listener.h"
+#include "system/iso8601.h"
 
-WSClient* ws_client;
-
-void webSocketClientEvent(WStype_t type, uint8_t* payload, size_t length) {
-  switch (type) {
-    case WStype_DISCONNECTED:
-      ws_client->on_disconnected();
-      break;
-    case WStype_ERROR:
-      ws_client->on_error();
-      break;
-    case WStype_CONNECTED:
-      ws_client->on_connected(payload);
-      break;
-    case WStype_TEXT:
-      ws_client->on_receive_delta(payload);
-      break;
-    default:
-      // Do nothing for other types
-      break;
-  }
-}
+// Maximum random delay (ms) before reconnecting after an established
+// connection was lost. Spreads the reconnects of many devices after
+// a server restart.
+#ifndef WS_RECONNECT_JITTER
+#define WS_RECONNECT_JITTER 10000
+#endif
+
+// Time (ms) to wait for the websocket handshake to complete
+#ifndef WS_CONNECT_TIMEOUT
+#define WS_CONNECT_TIMEOUT 15000
+#endif
 
-WSClient::WSClient(String config_path, SKDelta* sk_delta,
-                   std::function<void(bool)> connected_cb,
-                   void_cb_func delta_cb)
+WSClient::WSClient(String config_path, ServerDiscovery* discovery,
+                   std::function<void(bool)> connected_cb)
     : Configurable{config_path} {
-  this->sk_delta = sk_delta;
+  this->discovery = discovery;
   this->connected_cb = connected_cb;
-  this->delta_cb = delta_cb;
-
-  // set the singleton object pointer
-  ws_client = this;
 
   load_configuration();
+  discovery->set_preferred(last_good_address, last_good_port);
 }
 
 void WSClient::enable() {
   app.onDelay(0, [this]() { this->connect(); });
   app.onRepeat(20, [this]() { this->loop(); });
-  app.onRepeat(100, [this]() { this->send_delta(); });
-  app.onRepeat(10000, [this]() { this->connect_loop(); });
+  app.onRepeat(1000, [this]() { this->connect_loop(); });
 }
 
 void WSClient::connect_loop() {
-  if (this->connection_state == disconnected) {
-    this->connect();
+  if (this->connection_state == connecting && ws_connect_started != 0 &&
+      millis() - ws_connect_started > WS_CONNECT_TIMEOUT) {
+    // the websocket library doesn't report refused connections;
+    // it just keeps retrying. Take over and back off instead.
+    debugW("Websocket connection timed out");
+    this->client.disconnect();
+    this->on_connection_failure(ws_refused);
+  } else if (this->connection_state == disconnected && !reconnect_scheduled) {
+    this->schedule_reconnect(random(WS_RECONNECT_JITTER));
+  }
+  if (this->connection_state == connected) {
+    this->update_time_connected();
   }
 }
 
-void WSClient::on_disconnected() {
-  if (this->connection_state == connecting && server_detected) {
-    // Going from connecting directly to disconnect when we
-    // know we have found and talked to the server usually means
-    // the authentication token is bad.
-    debugW("Bad access token detected. Setting token to null.");
-    auth_token = NULL_AUTH_TOKEN;
-    save_configuration();
+void WSClient::schedule_reconnect(uint32_t delay) {
+  if (reconnect_scheduled) {
+    return;
+  }
+  reconnect_scheduled = true;
+  debugD("Reconnecting in %u ms", delay);
+  app.onDelay(delay, [this]() {
+    this->reconnect_scheduled = false;
+    this->connect();
+  });
+}
+
+void WSClient::on_connection_failure(ConnectionFailure failure) {
+  this->connection_state = disconnected;
+  ws_connect_started = 0;
+  server_detected = false;
+  if (skipped_token_test) {
+    // test the token properly on the next attempt
+    token_verified = false;
   }
+  if (server_address.length() == 0 && current_address.length() > 0) {
+    // let the discovery cache fall back to another server
+    discovery->report_failure(current_address, current_port);
+  }
+  this->schedule_reconnect(backoffs[failure].next_delay());
+}
+
+void WSClient::on_connection_lost() {
+  this->update_time_connected();
   this->connection_state = disconnected;
   server_detected = false;
+  if (server_address.length() == 0) {
+    discovery->release(current_address, current_port);
+  }
+  // don't let all devices hit the server at the same time
+  this->schedule_reconnect(random(WS_RECONNECT_JITTER));
+}
+
+void WSClient::update_time_connected() {
+  uint32_t now = millis();
+  connected_total += now - connected_since;
+  connected_since = now;
+  stats.time_connected.set(connected_total / 1000.);
+}
+
+void WSClient::on_disconnected() {
+  if (this->connection_state == connecting) {
+    if (server_detected) {
+      // Going from connecting directly to disconnect when we
+      // know we have found and talked to the server usually means
+      // the authentication token is bad.
+      debugW("Bad access token detected. Setting token to null.");
+      auth_token = NULL_AUTH_TOKEN;
+      save_configuration();
+      this->on_connection_failure(token_rejected);
+    } else {
+      this->on_connection_failure(ws_refused);
+    }
+  } else if (this->connection_state == connected) {
+    this->on_connection_lost();
+  }
   this->connected_cb(false);
 }
 
 void WSClient::on_error() {
-  this->connection_state = disconnected;
   debugW("Websocket client error.");
+  if (this->connection_state == connected) {
+    this->on_connection_lost();
+  } else {
+    this->on_connection_failure(ws_refused);
+  }
   this->connected_cb(false);
 }
 
 void WSClient::on_connected(uint8_t* payload) {
   this->connection_state = connected;
   debugI("Websocket client connected to URL: %s\n", payload);
+
+  ws_connect_started = 0;
+  for (auto& backoff : backoffs) {
+    backoff.reset();
+  }
+  uint32_t now = millis();
+  connected_since = now;
+  stats.connect_successes.set(stats.connect_successes.get() + 1);
+  stats.time_to_connect.set((now - attempt_started) / 1000.);
+  attempt_started = 0;
+
+  token_verified = true;
+  if (server_address.length() == 0) {
+    discovery->report_success(current_address, current_port);
+  }
+  if (current_address != last_good_address || current_port != last_good_port) {
+    last_good_address = current_address;
+    last_good_port = current_port;
+    save_configuration();
+  }
+
   this->connected_cb(true);
   debugI("Subscribing to SignalK listeners...");
   this->subscribe_listeners();
@@ -126,6 +195,11 @@ void WSClient::subscribe_listeners() {
 }
 
 void WSClient::on_receive_delta(uint8_t* payload) {
+  if (!listening) {
+    // another client is feeding the listeners
+    return;
+  }
+
   #ifdef SIGNALK_PRINT_RCV_DELTA
   debugD("Websocket payload received: %s", (char*)payload);
   #endif
@@ -134,6 +208,15 @@ void WSClient::on_receive_delta(uint8_t* payload) {
   JsonObject& message = jsonBuffer.parseObject(String((char*)payload));
 
   if (message.success()) {
+    if (message.containsKey("self") && message.containsKey("timestamp")) {
+      // the hello message carries the current server time
+      int64_t server_time;
+      if (parse_iso8601(message["timestamp"], &server_time)) {
+        sensesp_app->get_time_sync()->add_sample(time_source_server,
+                                                 server_time);
+      }
+    }
+
     JsonArray& updates = message["updates"];
 
     for (size_t i = 0; i < updates.size(); i++) {
@@ -162,20 +245,6 @@ void WSClient::on_receive_delta(uint8_t* payload) {
   }
 }
 
-bool WSClient::get_mdns_service(String& server_address, uint16_t& server_port) {
-  // get IP address using an mDNS query
-  int n = MDNS.queryService("signalk-ws", "tcp");
-  if (n == 0) {
-    // no service found
-    return false;
-  } else {
-    server_address = MDNS.IP(0).toString();
-    server_port = MDNS.port(0);
-    debugI("Found server %s (port %d)", server_address.c_str(), server_port);
-    return true;
-  }
-}
-
 void WSClient::connect() {
   if (connection_state != disconnected) {
     return;
@@ -183,27 +252,35 @@ void WSClient::connect() {
   debugD("Initiating connection");
 
   connection_state = connecting;
+  skipped_token_test = false;
+  if (attempt_started == 0) {
+    attempt_started = millis();
+  }
+  stats.connect_attempts.set(stats.connect_attempts.get() + 1);
 
   String server_address = "";
   uint16_t server_port = 80;
 
-  if (this->server_address.length() == 0) {
-    if (!get_mdns_service(server_address, server_port)) {
-       debugI("No mDNS service found by get_mdns_service");
-    }
-  } else {
+  if (this->server_address.length() > 0) {
     server_address = this->server_address;
     server_port = this->server_port;
+  } else if (!discovery->get_endpoint(server_address, server_port)) {
+    debugI("No Signal K server found");
   }
 
   if ((server_address.length() > 0) && (server_port > 0)) {
     debugD("Websocket client starting");
   } else {
     // host and port not defined - wait for mDNS
-    connection_state = disconnected;
+    current_address = "";
+    current_port = 0;
+    this->on_connection_failure(no_server_found);
     return;
   }
 
+  current_address = server_address;
+  current_port = server_port;
+
   if (this->polling_href != "") {
     // existing pending request
     this->poll_access_request(server_address, server_port, this->polling_href);
@@ -216,6 +293,17 @@ void WSClient::connect() {
     this->send_access_request(server_address, server_port);
     return;
   }
+
+  if (token_verified && server_address == last_good_address &&
+      server_port == last_good_port) {
+    // this server accepted the token earlier in this session:
+    // skip the HTTP round trip and open the websocket right away
+    debugD("Reconnecting to %s without testing the token",
+           server_address.c_str());
+    skipped_token_test = true;
+    this->connect_ws(server_address, server_port);
+    return;
+  }
   this->test_token(server_address, server_port);
 }
 
@@ -251,11 +339,11 @@ void WSClient::test_token(const String server_address,
     } else if (httpCode == 401) {
       this->send_access_request(server_address, server_port);
     } else {
-      connection_state = disconnected;
+      this->on_connection_failure(http_error);
     }
   } else {
     debugE("GET... failed, error: %s\n", http.errorToString(httpCode).c_str());
-    connection_state = disconnected;
+    this->on_connection_failure(http_error);
   }
 }
 
@@ -293,7 +381,7 @@ void WSClient::send_access_request(const String server_address,
   if (httpCode != 202) {
     debugW("Can't handle response %d to access request.", httpCode);
     debugD("%s", payload.c_str());
-    connection_state = disconnected;
+    this->on_connection_failure(http_error);
     return;
   }
 
@@ -304,7 +392,7 @@ void WSClient::send_access_request(const String server_address,
 
   if (state != "PENDING") {
     debugW("Got unknown state: %s", state.c_str());
-    connection_state = disconnected;
+    this->on_connection_failure(http_error);
     return;
   }
 
@@ -349,7 +437,7 @@ void WSClient::poll_access_request(const String server_address,
 
       if (permission == "DENIED") {
         debugW("Permission denied");
-        connection_state = disconnected;
+        this->on_connection_failure(token_rejected);
         return;
       } else if (permission == "APPROVED") {
         debugI("Permission granted");
@@ -371,12 +459,12 @@ void WSClient::poll_access_request(const String server_address,
       debugD("Got 500, probably a non-existing request.");
       polling_href = "";
       save_configuration();
-      connection_state = disconnected;
+      this->on_connection_failure(http_error);
       return;
     }
     // any other HTTP status code
     debugW("Can't handle response %d to pending access request.\n", httpCode);
-    connection_state = disconnected;
+    this->on_connection_failure(http_error);
     return;
   }
 }
@@ -385,31 +473,67 @@ void WSClient::connect_ws(const String host, const uint16_t port) {
   String path = "/signalk/v1/stream?subscribe=none";
 
   this->client.begin(host, port, path);
-  this->client.onEvent(webSocketClientEvent);
+  this->client.set_compression(compression);
+  this->client.onEvent(
+      [this](WStype_t type, uint8_t* payload, size_t length) {
+        switch (type) {
+          case WStype_DISCONNECTED:
+            this->on_disconnected();
+            break;
+          case WStype_ERROR:
+            this->on_error();
+            break;
+          case WStype_CONNECTED:
+            this->on_connected(payload);
+            break;
+          case WStype_TEXT:
+            this->on_receive_delta(payload);
+            break;
+          default:
+            // Do nothing for other types
+            break;
+        }
+      });
   String full_token = String("JWT ") + auth_token;
   this->client.setAuthorization(full_token.c_str());
+  ws_connect_started = millis();
 }
 
-void WSClient::loop() { this->client.loop(); }
+void WSClient::loop() {
+  // while disconnected, the websocket library would reconnect on its
+  // own schedule, bypassing the backoff
+  if (connection_state != disconnected) {
+    this->client.loop();
+  }
+}
 
 bool WSClient::is_connected() { return connection_state == connected; }
 
 void WSClient::restart() {
   if (connection_state == connected) {
     this->client.disconnect();
-    connection_state = disconnected;
+    if (connection_state == connected) {
+      this->on_connection_lost();
+    }
   }
 }
 
-void WSClient::send_delta() {
-  String output;
-  if (sk_delta->data_available()) {
-    sk_delta->get_delta(output);
-    if (connection_state == connected) {
-      this->client.sendTXT(output);
-      this->delta_cb();
-    }
+bool WSClient::send_txt(String& payload) {
+  if (connection_state != connected) {
+    return false;
   }
+  return this->client.sendTXT(payload);
+}
+
+bool WSClient::is_compressing() {
+  return connection_state == connected && this->client.compression_accepted();
+}
+
+bool WSClient::send_compressed(const std::vector<uint8_t>& payload) {
+  if (connection_state != connected) {
+    return false;
+  }
+  return this->client.send_compressed_txt(payload);
 }
 
 JsonObject& WSClient::get_configuration(JsonBuffer& buf) {
@@ -419,6 +543,9 @@ JsonObject& WSClient::get_configuration(JsonBuffer& buf) {
   root["token"] = this->auth_token;
   root["client_id"] = this->client_id;
   root["polling_href"] = this->polling_href;
+  root["compression"] = this->compression;
+  root["last_good_address"] = this->last_good_address;
+  root["last_good_port"] = this->last_good_port;
   return root;
 }
 
@@ -429,11 +556,14 @@ static const char SCHEMA[] PROGMEM = R"({
         "sk_port": { "title": "SignalK server port", "type": "integer" },
         "client_id": { "title": "Client ID", "type": "string", "readOnly": true },
         "token": { "title": "Server authorization token", "type": "string" },
-        "polling_href": { "title": "Server authorization polling href", "type": "string", "readOnly": true }
+        "polling_href": { "title": "Server authorization polling href", "type": "string", "readOnly": true },
+        "compression": { "title": "Compress deltas", "type": "boolean", "description": "Use permessage-deflate if the server supports it" },
+        "last_good_address": { "title": "Last connected server address", "type": "string", "readOnly": true },
+        "last_good_port": { "title": "Last connected server port", "type": "integer", "readOnly": true }
     }
   })";
 
-String WSClient::get_config_schema() { return FPSTR(SCHEMA); }
+PGM_P WSClient::get_config_schema_P() { return SCHEMA; }
 
 bool WSClient::set_configuration(const JsonObject& config) {
   String expected[] = {"sk_address", "sk_port", "token", "client_id"};
@@ -448,5 +578,12 @@ bool WSClient::set_configuration(const JsonObject& config) {
   this->auth_token = config["token"].as<String>();
   this->client_id = config["client_id"].as<String>();
   this->polling_href = config["polling_href"].as<String>();
+  if (config.containsKey("compression")) {
+    this->compression = config["compression"];
+  }
+  if (config.containsKey("last_good_address")) {
+    this->last_good_address = config["last_good_address"].as<String>();
+    this->last_good_port = config["last_good_port"].as<int>();
+  }
   return true;
 }
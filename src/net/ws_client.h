@@ -3,21 +3,46 @@
 #include <set>
 #include <functional>
 
-#include <WebSocketsClient.h>
-
 #include "sensesp.h"
+#include "net/backoff.h"
+#include "net/deflate_websockets_client.h"
+#include "net/server_discovery.h"
 #include "system/configurable.h"
-#include "signalk/signalk_delta.h"
+#include "system/observablevalue.h"
 
 static const char* NULL_AUTH_TOKEN = "";
 
 enum ConnectionState { disconnected, connecting, connected };
 
+// Reasons for a failed connection attempt. Each of them is retried
+// on its own backoff schedule.
+enum ConnectionFailure {
+  no_server_found,  // no server address configured and no mDNS answer
+  http_error,       // HTTP request failed or returned an unexpected status
+  ws_refused,       // websocket handshake failed or timed out
+  token_rejected,   // server rejected the token or denied the access request
+  num_connection_failures
+};
+
+/**
+ * Connection telemetry of a WSClient. The values can be connected
+ * to SKOutputs like any other producer.
+ */
+struct WSClientStats {
+  // number of connection attempts since boot
+  ObservableValue<int> connect_attempts{0};
+  // number of successfully established connections since boot
+  ObservableValue<int> connect_successes{0};
+  // seconds from the first attempt to the latest established connection
+  ObservableValue<float> time_to_connect{0};
+  // cumulative seconds spent connected since boot
+  ObservableValue<float> time_connected{0};
+};
+
 class WSClient : public Configurable {
  public:
-  WSClient(String config_path, SKDelta* sk_delta,
-            std::function<void(bool)> connected_cb,
-            void_cb_func delta_cb);
+  WSClient(String config_path, ServerDiscovery* discovery,
+            std::function<void(bool)> connected_cb);
   void enable();
   void on_disconnected();
   void on_error();
@@ -27,11 +52,18 @@ class WSClient : public Configurable {
   void loop();
   bool is_connected();
   void restart();
-  void send_delta();
+  bool send_txt(String& payload);
+  /// Returns true if the connected server accepts compressed messages
+  bool is_compressing();
+  /// Sends a message compressed with a DeflateEncoder
+  bool send_compressed(const std::vector<uint8_t>& payload);
+  /// Enables or disables passing received deltas to the SKListeners
+  void set_listening(bool listening) { this->listening = listening; }
+  WSClientStats* get_stats() { return &stats; }
 
   virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
   virtual bool set_configuration(const JsonObject& config) override final;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
  private:
   String server_address = "";
@@ -40,20 +72,49 @@ class WSClient : public Configurable {
   String polling_href = "";
   String auth_token = NULL_AUTH_TOKEN;
   bool server_detected = false;
+  // offer permessage-deflate to the server
+  bool compression = false;
+
+  // last server that accepted a websocket connection
+  String last_good_address = "";
+  uint16_t last_good_port = 0;
+  // the token was accepted by the last good server during this session
+  bool token_verified = false;
+  // the attempt in progress skipped the HTTP token test
+  bool skipped_token_test = false;
+  // server used by the connection attempt in progress
+  String current_address = "";
+  uint16_t current_port = 0;
+
+  Backoff backoffs[num_connection_failures] = {
+    {5000, 120000},   // no_server_found
+    {5000, 120000},   // http_error
+    {2000, 60000},    // ws_refused
+    {10000, 300000},  // token_rejected
+  };
+  bool listening = true;
+  bool reconnect_scheduled = false;
+  uint32_t attempt_started = 0;
+  uint32_t ws_connect_started = 0;
+  uint32_t connected_since = 0;
+  uint32_t connected_total = 0;
+  WSClientStats stats;
 
   // FIXME: replace with a single connection_state enum
   ConnectionState connection_state = disconnected;
-  WebSocketsClient client;
-  SKDelta* sk_delta;
+  DeflateWebSocketsClient client;
+  ServerDiscovery* discovery;
   void connect_loop();
+  void schedule_reconnect(uint32_t delay);
+  void on_connection_failure(ConnectionFailure failure);
+  void update_time_connected();
   void test_token(const String host, const uint16_t port);
   void send_access_request(const String host, const uint16_t port);
   void poll_access_request(const String host, const uint16_t port, const String href);
   void connect_ws(const String host, const uint16_t port);
   void subscribe_listeners();
   std::function<void(bool)> connected_cb;
-  void_cb_func delta_cb;
-  bool get_mdns_service(String &server_address, uint16_t& server_port);
+  void on_connection_lost();
 };
 
 #endif
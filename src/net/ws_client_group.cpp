@@ -0,0 +1,136 @@
+#include "ws_client_group.h"
+
+WSClientGroup::WSClientGroup(String config_path, SKDelta* sk_delta,
+                             ServerDiscovery* discovery,
+                             std::function<void(bool)> connected_cb,
+                             void_cb_func delta_cb)
+    : Configurable{config_path} {
+  this->sk_delta = sk_delta;
+  this->connected_cb = connected_cb;
+  this->delta_cb = delta_cb;
+  this->discovery = discovery;
+
+  load_configuration();
+
+  auto client_connected_cb = [this](bool connected) {
+    this->update_primary();
+    this->connected_cb(this->is_connected());
+  };
+  for (int i = 0; i < num_servers; i++) {
+    String client_path = "/system/sk";
+    if (i > 0) {
+      client_path += String("_") + (i + 1);
+    }
+    clients.push_back(
+        new WSClient(client_path, discovery, client_connected_cb));
+  }
+  update_primary();
+}
+
+void WSClientGroup::enable() {
+  for (auto* client : clients) {
+    client->enable();
+  }
+  app.onRepeat(100, [this]() { this->send_delta(); });
+}
+
+bool WSClientGroup::is_connected() {
+  for (auto* client : clients) {
+    if (client->is_connected()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WSClientGroup::update_primary() {
+  primary = -1;
+  for (size_t i = 0; i < clients.size(); i++) {
+    if (primary < 0 && clients[i]->is_connected()) {
+      primary = i;
+    }
+    clients[i]->set_listening(primary == (int)i);
+  }
+}
+
+void WSClientGroup::send_delta() {
+  // values of other vessels arrive in messages of their own
+  for (int i = 0; i < MAX_DELTAS_PER_SEND && sk_delta->data_available();
+       i++) {
+    String output;
+    sk_delta->get_delta(output);
+    this->send_message(output);
+  }
+}
+
+void WSClientGroup::send_message(String& output) {
+  std::vector<WSClient*> destinations;
+  if (mode == fanout) {
+    destinations = clients;
+  } else if (primary >= 0) {
+    destinations.push_back(clients[primary]);
+  }
+
+  bool compressed_ready = false;
+  bool sent = false;
+  for (auto* client : destinations) {
+    if (client->is_compressing()) {
+      if (!compressed_ready) {
+        this->compress(output);
+        compressed_ready = true;
+      }
+      sent |= client->send_compressed(compressed);
+    } else {
+      sent |= client->send_txt(output);
+    }
+  }
+  if (sent) {
+    this->delta_cb();
+  }
+}
+
+void WSClientGroup::compress(const String& delta) {
+  uint32_t start = micros();
+  compressed.clear();
+  encoder.compress((const uint8_t*)delta.c_str(), delta.length(), compressed);
+  compress_micros += micros() - start;
+  compressed_deltas++;
+  uncompressed_bytes += delta.length();
+  compressed_bytes += compressed.size();
+  compression_stats.ratio.set((float)uncompressed_bytes / compressed_bytes);
+  compression_stats.time_per_delta.set((float)compress_micros /
+                                       compressed_deltas);
+}
+
+JsonObject& WSClientGroup::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["mode"] = mode == fanout ? "fanout" : "failover";
+  root["num_servers"] = num_servers;
+  return root;
+}
+
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "mode": { "title": "Output mode", "type": "string", "enum": ["failover", "fanout"], "description": "failover: send to the first connected server; fanout: send to all connected servers" },
+        "num_servers": { "title": "Number of Signal K servers", "type": "integer", "minimum": 1, "maximum": 4, "description": "Takes effect after a restart" }
+    }
+  })";
+
+PGM_P WSClientGroup::get_config_schema_P() { return SCHEMA; }
+
+bool WSClientGroup::set_configuration(const JsonObject& config) {
+  String expected[] = {"mode", "num_servers"};
+  for (auto str : expected) {
+    if (!config.containsKey(str)) {
+      return false;
+    }
+  }
+  String mode_str = config["mode"].as<String>();
+  this->mode = mode_str == "fanout" ? fanout : failover;
+  // in fan-out mode, each server gets the deltas from one client only
+  discovery->set_share_servers(mode == failover);
+  int num_servers = config["num_servers"];
+  this->num_servers = max(1, min(num_servers, MAX_SK_SERVERS));
+  return true;
+}
@@ -0,0 +1,95 @@
+#ifndef _ws_client_group_H_
+#define _ws_client_group_H_
+
+#include <vector>
+
+#include "sensesp.h"
+#include "net/deflate.h"
+#include "net/server_discovery.h"
+#include "net/ws_client.h"
+#include "signalk/signalk_delta.h"
+#include "system/configurable.h"
+
+// Maximum number of Signal K servers the deltas can be sent to
+#ifndef MAX_SK_SERVERS
+#define MAX_SK_SERVERS 4
+#endif
+
+// Delta messages sent per round. The own vessel's values go into one
+// message; each other vessel, e.g. an AIS target, needs a message of
+// its own.
+#ifndef MAX_DELTAS_PER_SEND
+#define MAX_DELTAS_PER_SEND 8
+#endif
+
+enum SKOutputMode {
+  // send to the first connected server only
+  failover,
+  // send to every connected server
+  fanout
+};
+
+/**
+ * Benefit and cost of the delta compression, averaged since boot.
+ */
+struct CompressionStats {
+  // uncompressed bytes divided by compressed bytes
+  ObservableValue<float> ratio{1};
+  // microseconds spent compressing one delta
+  ObservableValue<float> time_per_delta{0};
+};
+
+/**
+ * WSClientGroup sends the Signal K deltas to one or more servers. Each
+ * server has its own WSClient with an independent connection state
+ * machine. Every delta is serialized once and the same frame is handed
+ * to all destinations. Destinations that negotiated permessage-deflate
+ * share a single compressed copy of the frame.
+ *
+ * The first WSClient is configured at /system/sk as before, the others
+ * at /system/sk_2 ... /system/sk_N. The number of servers takes effect
+ * after a restart.
+ *
+ * Deltas received from the servers are passed to the SKListeners from
+ * the first connected server only.
+ */
+class WSClientGroup : public Configurable {
+ public:
+  WSClientGroup(String config_path, SKDelta* sk_delta,
+                ServerDiscovery* discovery,
+                std::function<void(bool)> connected_cb,
+                void_cb_func delta_cb);
+  void enable();
+  bool is_connected();
+  void send_delta();
+  WSClient* get_client(size_t i) { return clients.at(i); }
+  size_t get_num_clients() { return clients.size(); }
+  CompressionStats* get_compression_stats() { return &compression_stats; }
+
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
+  virtual bool set_configuration(const JsonObject& config) override final;
+  virtual PGM_P get_config_schema_P() override;
+
+ private:
+  SKOutputMode mode = failover;
+  int num_servers = 1;
+  std::vector<WSClient*> clients;
+  SKDelta* sk_delta;
+  ServerDiscovery* discovery;
+  std::function<void(bool)> connected_cb;
+  void_cb_func delta_cb;
+  // index of the first connected client, or -1
+  int primary = -1;
+  DeflateEncoder encoder{WS_DEFLATE_WINDOW_BITS};
+  std::vector<uint8_t> compressed;
+  CompressionStats compression_stats;
+  uint64_t uncompressed_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  uint64_t compress_micros = 0;
+  uint32_t compressed_deltas = 0;
+  void update_primary();
+  void send_message(String& output);
+  void compress(const String& delta);
+};
+
+#endif
@@ -1,18 +1,13 @@
 #include "sensesp_app.h"
 
-#ifdef ESP8266
-#include "FS.h"
-#elif defined(ESP32)
-#include "SPIFFS.h"
-#endif
-
 #include "sensors/analog_input.h"
 #include "sensors/digital_input.h"
 #include "sensors/system_info.h"
 #include "net/discovery.h"
 #include "net/ota.h"
 #include "net/networking.h"
-#include "system/spiffs_storage.h"
+#include "system/config_store.h"
+#include "system/storage.h"
 #include "transforms/transform.h"
 #include "transforms/difference.h"
 #include "transforms/frequency.h"
@@ -27,15 +22,7 @@ RemoteDebug Debug;
 
 SensESPApp::SensESPApp(StdSensors_t stdSensors) : stdSensors{stdSensors} {
   // initialize filesystem
-
-#ifdef ESP8266
-  if (!SPIFFS.begin()) {
-#elif defined(ESP32)
-  if (!SPIFFS.begin(true)) {
-#endif
-    debugE("FATAL: Filesystem initialization failed.");
-    ESP.restart();
-  }
+  setup_storage();
 
   // create the networking object
   networking = new Networking("/system/networking");
@@ -45,9 +32,13 @@ SensESPApp::SensESPApp(StdSensors_t stdSensors) : stdSensors{stdSensors} {
 
   setup_standard_sensors(hostname, stdSensors);
 
+  // create the clock for timestamping the deltas
+
+  time_sync = new TimeSync("/system/time");
+
   // create the SK delta object
 
-  sk_delta = new SKDelta(hostname->get());
+  sk_delta = new SKDelta(hostname->get(), 20, time_sync);
 
   // listen for hostname updates
 
@@ -59,7 +50,7 @@ SensESPApp::SensESPApp(StdSensors_t stdSensors) : stdSensors{stdSensors} {
 
   this->http_server = new HTTPServer(std::bind(&SensESPApp::reset, this));
 
-  // create the websocket client
+  // create the websocket clients
 
   auto ws_connected_cb = [this](bool connected){
     if (connected) {
@@ -71,9 +62,10 @@ SensESPApp::SensESPApp(StdSensors_t stdSensors) : stdSensors{stdSensors} {
   auto ws_delta_cb = [this](){
     this->led_blinker.flip();
   };
-  this->ws_client = new WSClient(
-    "/system/sk",
-    sk_delta, ws_connected_cb, ws_delta_cb);
+  this->server_discovery = new ServerDiscovery("signalk-ws", "tcp");
+  this->ws_clients = new WSClientGroup(
+    "/system/sk_output",
+    sk_delta, server_discovery, ws_connected_cb, ws_delta_cb);
 }
 
 void SensESPApp::setup_standard_sensors(ObservableValue<String>* hostname, StdSensors_t stdSensors) {
@@ -149,13 +141,19 @@ void SensESPApp::enable() {
     }
   });
 
+  debugI("Subsystem: time_sync()");
+  this->time_sync->enable();
+
+  debugI("Subsystem: server_discovery()");
+  this->server_discovery->enable();
+
   debugI("Subsystem: setup_OTA()");
   setup_OTA();
   
   debugI("Subsystem: http_server()");
   this->http_server->enable();
-  debugI("Subsystem: ws_client()");
-  this->ws_client->enable();
+  debugI("Subsystem: ws_clients()");
+  this->ws_clients->enable();
 
   debugI("WS client enabled");
 
@@ -170,12 +168,19 @@ void SensESPApp::enable() {
   Enable::enableAll();
   debugI("All sensors and transforms enabled");
 
+  // all Configurables have been created by now
+  configurables.build();
+
+  // write the configuration changes from the main loop
+  config_store.enable();
+
 }
 
 void SensESPApp::reset() {
   debugW("Resetting the device configuration.");
   networking->reset_settings();
-  SPIFFS.format();
+  config_store.clear();
+  storage->format();
   app.onDelay(1000, [](){ ESP.restart(); });
 }
 
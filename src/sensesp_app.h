@@ -7,9 +7,11 @@
 #include "sensors/sensor.h"
 #include "net/http.h"
 #include "net/networking.h"
-#include "net/ws_client.h"
+#include "net/server_discovery.h"
+#include "net/ws_client_group.h"
 #include "sensesp.h"
 #include "system/led_blinker.h"
+#include "system/time_sync.h"
 #include "signalk/signalk_delta.h"
 #include "system/valueproducer.h"
 #include "system/valueconsumer.h"
@@ -56,10 +58,29 @@ class SensESPApp {
 
 
   /**
-   * Returns true if the host system is connected to a SignalK server
+   * Returns true if the host system is connected to at least one
+   * SignalK server
    */
   bool isSignalKConnected() {
-    return ws_client->is_connected();
+    return ws_clients->is_connected();
+  }
+
+
+  /**
+   * Returns the connection telemetry of the websocket client
+   * of the given Signal K server
+   */
+  WSClientStats* get_ws_client_stats(size_t server = 0) {
+    return ws_clients->get_client(server)->get_stats();
+  }
+
+  /// Returns the clock used for timestamping the deltas
+  TimeSync* get_time_sync() { return time_sync; }
+  SKDelta* get_sk_delta() { return sk_delta; }
+
+  /// Returns the compression ratio and cost of the outgoing deltas
+  CompressionStats* get_compression_stats() {
+    return ws_clients->get_compression_stats();
   }
 
 
@@ -70,8 +91,10 @@ class SensESPApp {
   HTTPServer* http_server;
   LedBlinker led_blinker;
   Networking* networking;
+  TimeSync* time_sync;
   SKDelta* sk_delta;
-  WSClient* ws_client;
+  ServerDiscovery* server_discovery;
+  WSClientGroup* ws_clients;
 
 };
 
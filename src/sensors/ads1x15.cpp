@@ -49,22 +49,20 @@ template <class T_ads_1x15>
 JsonObject& ADS1x15value<T_ads_1x15>::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["read_delay"] = read_delay;
-  root["value"] = output;
   return root;
   };
 
   static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" }
     }
   })###";
 
 
   template <class T_ads_1x15>
-  String ADS1x15value<T_ads_1x15>::get_config_schema() {
-  return FPSTR(SCHEMA);
+  PGM_P ADS1x15value<T_ads_1x15>::get_config_schema_P() {
+  return SCHEMA;
 }
 
 template <class T_ads_1x15>
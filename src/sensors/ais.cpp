@@ -0,0 +1,67 @@
+#include "ais.h"
+
+#include "sensesp.h"
+#include "sensesp_app.h"
+
+// Number of characters read from the serial port at a time
+#ifndef AIS_READ_CHUNK_SIZE
+#define AIS_READ_CHUNK_SIZE 64
+#endif
+
+AISInput::AISInput(Stream* rx_stream, String config_path)
+    : Sensor(config_path),
+      decoder{[](const String& context, const String& values) {
+        if (sensesp_app != nullptr) {
+          sensesp_app->get_sk_delta()->append_context(context, values);
+        }
+      }} {
+  className = "AISInput";
+  this->rx_stream = rx_stream;
+
+  nmea_parser.add_sentence_parser(new VDMSentenceParser(&decoder, "VDM"));
+  nmea_parser.add_sentence_parser(new VDMSentenceParser(&decoder, "VDO"));
+
+  load_configuration();
+}
+
+void AISInput::enable() {
+  app.onAvailable(*rx_stream, [this](){
+    char buf[AIS_READ_CHUNK_SIZE];
+    int available;
+    while ((available = this->rx_stream->available()) > 0) {
+      size_t len = this->rx_stream->readBytes(
+          buf, min(available, (int)sizeof(buf)));
+      nmea_parser.handle(buf, len);
+    }
+  });
+}
+
+JsonObject& AISInput::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["position_interval"] = position_interval;
+  root["static_interval"] = static_interval;
+  return root;
+}
+
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "position_interval": { "title": "Position update interval", "type": "integer", "description": "Shortest interval (ms) at which the position of a vessel is updated" },
+        "static_interval": { "title": "Static data update interval", "type": "integer", "description": "Shortest interval (ms) at which the name, dimensions and voyage data of a vessel are updated" }
+    }
+  })";
+
+PGM_P AISInput::get_config_schema_P() { return SCHEMA; }
+
+bool AISInput::set_configuration(const JsonObject& config) {
+  String expected[] = {"position_interval", "static_interval"};
+  for (auto str : expected) {
+    if (!config.containsKey(str)) {
+      return false;
+    }
+  }
+  position_interval = config["position_interval"];
+  static_interval = config["static_interval"];
+  decoder.set_intervals(position_interval, static_interval);
+  return true;
+}
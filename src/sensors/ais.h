@@ -0,0 +1,34 @@
+#ifndef _sensors_ais_H_
+#define _sensors_ais_H_
+
+#include "sensor.h"
+#include "system/ais.h"
+#include "system/nmea_parser.h"
+
+// Support for an AIS transponder or receiver communicating with NMEA-0183
+// messages over a serial interface
+
+/**
+ * AISInput decodes the AIVDM and AIVDO sentences of an AIS transponder
+ * and sends the position and static data of the vessels around as
+ * Signal K deltas, each in the context of the vessel's MMSI. To keep
+ * busy harbours from flooding the connection, every vessel is updated
+ * at most once per configured interval.
+ */
+class AISInput : public Sensor {
+ public:
+  AISInput(Stream* rx_stream, String config_path="");
+  virtual void enable() override final;
+  AISDecoder* get_decoder() { return &decoder; }
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual PGM_P get_config_schema_P() override;
+ private:
+  Stream* rx_stream;
+  uint32_t position_interval = 5000;
+  uint32_t static_interval = 60000;
+  AISDecoder decoder;
+  NMEAParser nmea_parser;
+};
+
+#endif
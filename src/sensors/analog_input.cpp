@@ -23,20 +23,18 @@ void AnalogInput::enable() {
 JsonObject& AnalogInput::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["read_delay"] = read_delay;
-  root["value"] = output;
   return root;
   };
 
   static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "read_delay": { "title": "Read delay", "type": "number", "description": "Number of milliseconds between each analogRead(A0)" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "read_delay": { "title": "Read delay", "type": "number", "description": "Number of milliseconds between each analogRead(A0)" }
     }
   })###";
 
-  String AnalogInput::get_config_schema() {
-  return FPSTR(SCHEMA);
+  PGM_P AnalogInput::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool AnalogInput::set_configuration(const JsonObject& config) {
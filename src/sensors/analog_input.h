@@ -14,7 +14,7 @@ private:
   uint read_delay;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
   void update();
 };
 
@@ -30,20 +30,18 @@ void DigitalInputValue::enable() {
 JsonObject& DigitalInputValue::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["read_delay"] = read_delay;
-  root["value"] = output;
   return root;
   };
 
   static const char SCHEMA2[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" }
     }
   })###";
 
-  String DigitalInputValue::get_config_schema() {
-  return FPSTR(SCHEMA2);
+  PGM_P DigitalInputValue::get_config_schema_P() {
+  return SCHEMA2;
 }
 
 bool DigitalInputValue::set_configuration(const JsonObject& config) {
@@ -87,20 +85,18 @@ void DigitalInputCounter::enable() {
   JsonObject& DigitalInputCounter::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["read_delay"] = read_delay;
-  root["value"] = output;
   return root;
   };
 
   static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" }
     }
   })###";
 
-  String DigitalInputCounter::get_config_schema() {
-  return FPSTR(SCHEMA);
+  PGM_P DigitalInputCounter::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool DigitalInputCounter::set_configuration(const JsonObject& config) {
@@ -28,7 +28,7 @@ class DigitalInputValue : public DigitalInput, public IntegerProducer {
   int read_delay;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 };
 
 // DigitalInputCounter tracks rapidly changing digital inputs
@@ -45,7 +45,7 @@ class DigitalInputCounter : public DigitalInput, public IntegerProducer {
   volatile uint counter = 0;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 };
 
 #endif
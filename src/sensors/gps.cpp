@@ -4,15 +4,31 @@
 
 #include "sensesp.h"
 
+// Number of characters read from the serial port at a time
+#ifndef GPS_READ_CHUNK_SIZE
+#define GPS_READ_CHUNK_SIZE 64
+#endif
+
+// Live value ID prefix of the parser statistics of a GPSInput without a
+// config_path
+#ifndef GPS_STATS_PATH
+#define GPS_STATS_PATH "/sensors/gps"
+#endif
+
 GPSInput::GPSInput(Stream* rx_stream, String config_path)
     : Sensor(config_path) {
 
   className = "GPSInput";
   this->rx_stream = rx_stream;
 
-  nmea_parser.add_sentence_parser(new GPGGASentenceParser(&nmea_data));
-  nmea_parser.add_sentence_parser(new GPGLLSentenceParser(&nmea_data));
-  nmea_parser.add_sentence_parser(new GPRMCSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new GGASentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new GLLSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new RMCSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new VTGSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new GSASentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new GSVSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new HDTSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new ZDASentenceParser(&nmea_data));
   nmea_parser.add_sentence_parser(new PSTISentenceParser(&nmea_data));
   nmea_parser.add_sentence_parser(new PSTI030SentenceParser(&nmea_data));
   nmea_parser.add_sentence_parser(new PSTI032SentenceParser(&nmea_data));
@@ -23,18 +39,45 @@ GPSInput::GPSInput(Stream* rx_stream, String config_path)
 void GPSInput::enable() {
   // enable reading the serial port
   app.onAvailable(*rx_stream, [this](){
-    while (this->rx_stream->available()) {
-      nmea_parser.handle(this->rx_stream->read());
+    char buf[GPS_READ_CHUNK_SIZE];
+    int available;
+    while ((available = this->rx_stream->available()) > 0) {
+      size_t len = this->rx_stream->readBytes(
+          buf, min(available, (int)sizeof(buf)));
+      nmea_parser.handle(buf, len);
     }
   });
 
-  //#ifndef DEBUG_DISABLED
-  //app.onRepeat(1000, [this](){
-  //  debugD("GPS characters processed: %d", gps.charsProcessed());
-  //  debugD("Sentences with fix: %d", gps.sentencesWithFix());
-  //  debugD("Passed checksum: %d", gps.passedChecksum());
-  //  debugD("Failed checksum: %d", gps.failedChecksum());
-  //});
-  //#endif
+  // the statistics change all the time; they are served as live values
+  // instead of being part of the configuration
+  parser_stats.add_live_values(
+      (config_path != "" ? config_path : String(GPS_STATS_PATH)) + "/stats/");
+  app.onRepeat(NMEA_STATS_INTERVAL, [this]() {
+    this->parser_stats.update(nmea_parser);
+  });
+}
+
+
+JsonObject& GPSInput::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["talkers"] = talkers;
+  return root;
 }
 
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "talkers": { "title": "Accepted talkers", "type": "string", "description": "Comma separated talker IDs, e.g. GN,GP. Leave empty to accept all." }
+    }
+  })";
+
+PGM_P GPSInput::get_config_schema_P() { return SCHEMA; }
+
+bool GPSInput::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("talkers")) {
+    return false;
+  }
+  talkers = config["talkers"].as<String>();
+  nmea_parser.set_talker_filter(talkers);
+  return true;
+}
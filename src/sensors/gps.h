@@ -12,20 +12,31 @@ class GPSInput : public Sensor {
   GPSInput(Stream* rx_stream, String config_path="");
   virtual void enable() override final;
   NMEAData nmea_data;
+  /// Parser counters, updated every NMEA_STATS_INTERVAL
+  NMEAParserStats parser_stats;
+  /// Returns the number of sentences received per talker
+  const TalkerStats* get_talker_stats() {
+    return nmea_parser.get_talker_stats();
+  }
+  int get_num_talkers() { return nmea_parser.get_num_talkers(); }
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual PGM_P get_config_schema_P() override;
  private:
   Stream* rx_stream;
+  String talkers = "";
   NMEAParser nmea_parser;
 };
 
-// must parse the following sentences:
-// - GPGGA - Global Positioning System Fix Data
-// - GPGLL - Latitude/Longitude
-// - GPRMC - The Recommended Minimum
-// - GPVTG - Course Over Ground and Ground Speed
-// - GPGSA - GNSS DOP and Active Satellites
-// - GLGSA - GNSS DOP and Active Satellites
-// - GPGSV - GNSS Satellites in View
-// - GLGSV - GNSS Satellites in View
+// must parse the following sentences (from any talker):
+// - GGA - Global Positioning System Fix Data
+// - GLL - Latitude/Longitude
+// - RMC - The Recommended Minimum
+// - VTG - Course Over Ground and Ground Speed
+// - GSA - GNSS DOP and Active Satellites
+// - GSV - GNSS Satellites in View
+// - HDT - Heading, True
+// - ZDA - Time and Date
 // - PSTI,030 - Recommended Minimum 3D GNSS Data
 // - PSTI,032 - RTK Baseline Data
 
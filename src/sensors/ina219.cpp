@@ -55,21 +55,19 @@ void INA219value::enable() {
 JsonObject& INA219value::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["read_delay"] = read_delay;
-  root["value"] = output;
   return root;
   };
 
   static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "read_delay": { "title": "Read delay", "type": "number", "description": "The time, in milliseconds, between each read of the input" }
     }
   })###";
 
 
-  String INA219value::get_config_schema() {
-  return FPSTR(SCHEMA);
+  PGM_P INA219value::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool INA219value::set_configuration(const JsonObject& config) {
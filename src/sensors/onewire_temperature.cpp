@@ -146,7 +146,6 @@ void OneWireTemperature::read_value() {
 
 JsonObject& OneWireTemperature::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
-  root.set("value", output);
   char addr_str[24];
   owda_to_string(addr_str, address);
   root.set("address", addr_str);
@@ -158,13 +157,12 @@ static const char SCHEMA[] PROGMEM = R"({
     "type": "object",
     "properties": {
         "address": { "title": "OneWire address", "type": "string" },
-        "found": { "title": "Device found", "type": "boolean", "readOnly": true },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "found": { "title": "Device found", "type": "boolean", "readOnly": true }
     }
   })";
 
-String OneWireTemperature::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P OneWireTemperature::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool OneWireTemperature::set_configuration(const JsonObject& config) {
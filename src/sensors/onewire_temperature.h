@@ -31,7 +31,7 @@ class OneWireTemperature : public NumericSensor {
   void enable() override final;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
   virtual bool set_configuration(const JsonObject& config) override final;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
  private:
   OneWire* onewire;
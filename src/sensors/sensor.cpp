@@ -1,5 +1,7 @@
 #include "sensor.h"
 
+#include "system/live_values.h"
+
 std::set<Sensor*> Sensor::sensors;
 
 Sensor::Sensor(String config_path) : Configurable{config_path}, Enable(10) {
@@ -12,6 +14,9 @@ Sensor::Sensor(String config_path) : Configurable{config_path}, Enable(10) {
 NumericSensor::NumericSensor(String config_path) :
    Sensor(config_path), NumericProducer() {
       className = "NumericSensor";
+      if (config_path != "") {
+        live_values.add(this->config_path.c_str(), this);
+      }
 
 };
 
@@ -19,6 +24,9 @@ NumericSensor::NumericSensor(String config_path) :
 IntegerSensor::IntegerSensor(String config_path) :
    Sensor(config_path), IntegerProducer() {
       className = "IntegerSensor";
+      if (config_path != "") {
+        live_values.add(this->config_path.c_str(), this);
+      }
 
 };
 
@@ -26,5 +34,8 @@ IntegerSensor::IntegerSensor(String config_path) :
 StringSensor::StringSensor(String config_path) :
    Sensor(config_path), StringProducer() {
       className = "StringSensor";
+      if (config_path != "") {
+        live_values.add(this->config_path.c_str(), this);
+      }
 
 };
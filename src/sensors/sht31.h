@@ -38,7 +38,7 @@ class SHT31value : public NumericSensor {
     uint read_delay;
     virtual JsonObject& get_configuration(JsonBuffer& buf) override;
     virtual bool set_configuration(const JsonObject& config) override;
-    virtual String get_config_schema() override;
+    virtual PGM_P get_config_schema_P() override;
 
 };
 
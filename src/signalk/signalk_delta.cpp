@@ -3,39 +3,69 @@
 #include "Arduino.h"
 #include "ArduinoJson.h"
 #include "sensesp.h"
+#include "system/iso8601.h"
 
-SKDelta::SKDelta(const String& hostname, unsigned int max_buffer_size)
+SKDelta::SKDelta(const String& hostname, unsigned int max_buffer_size,
+                 TimeSync* time_sync)
 : hostname{hostname},
-  max_buffer_size{max_buffer_size} {}
+  max_buffer_size{max_buffer_size},
+  time_sync{time_sync} {}
 
 void SKDelta::append(const String val) {
+  if (buffer.empty() && time_sync != nullptr) {
+    batch_started = time_sync->monotonic_ms();
+  }
   if (buffer.size() >= max_buffer_size) {
     buffer.pop_back();
   }
   buffer.push_front(val);
 }
 
+void SKDelta::append_context(const String& context, const String& values) {
+  if (context_buffer.size() >= max_buffer_size) {
+    context_buffer.pop_front();
+  }
+  uint64_t received = time_sync != nullptr ? time_sync->monotonic_ms() : 0;
+  context_buffer.push_back(ContextUpdate{context, values, received});
+}
+
 bool SKDelta::data_available() {
-  return buffer.size() > 0;
+  return buffer.size() > 0 || context_buffer.size() > 0;
 }
 
 void SKDelta::get_delta(String& output) {
   DynamicJsonBuffer jsonBuffer;
 
   JsonObject& delta = jsonBuffer.createObject();
+  bool own_vessel = !buffer.empty();
+  if (!own_vessel) {
+    delta["context"] = context_buffer.front().context;
+  }
   JsonArray& updates = delta.createNestedArray("updates");
 
   JsonObject& current = updates.createNestedObject();
   JsonObject& source = current.createNestedObject("source");
   source["label"] = hostname;
-  JsonArray& values = current.createNestedArray("values");
-
-  while (!buffer.empty()) {
-    values.add(RawJson(buffer.back()));
-    buffer.pop_back();
+  char timestamp[ISO8601_BUFFER_SIZE];
+  if (time_sync != nullptr && time_sync->is_synced()) {
+    uint64_t started =
+        own_vessel ? batch_started : context_buffer.front().received;
+    format_iso8601(timestamp, time_sync->to_utc(started));
+    current["timestamp"] = (const char*)timestamp;
   }
 
-  delta.printTo(output);
+  if (own_vessel) {
+    JsonArray& values = current.createNestedArray("values");
+    while (!buffer.empty()) {
+      values.add(RawJson(buffer.back()));
+      buffer.pop_back();
+    }
+    delta.printTo(output);
+  } else {
+    current["values"] = RawJson(context_buffer.front().values);
+    delta.printTo(output);
+    context_buffer.pop_front();
+  }
 
   debugD("SKDelta::get_delta: %s", output.c_str());
 }
@@ -4,21 +4,50 @@
 #include <list>
 
 #include "ArduinoJson.h"
+#include "system/time_sync.h"
 
 ///////////////////
 // Signal K delta message representation
 
+/**
+ * SKDelta collects the values emitted by the SKEmitters and batches
+ * them into a single update. If a TimeSync is given and synchronized,
+ * the update is timestamped with the time its first value arrived.
+ *
+ * Values of other vessels, e.g. AIS targets, are queued separately and
+ * sent in a delta message of their own per context.
+ */
 class SKDelta {
  public:
-  SKDelta(const String& hostname, unsigned int max_buffer_size=20);
+  SKDelta(const String& hostname, unsigned int max_buffer_size=20,
+          TimeSync* time_sync=nullptr);
   void append(const String val);
+  /**
+   * Queues values with a context other than the own vessel.
+   * @param context E.g. "vessels.urn:mrn:imo:mmsi:230123456"
+   * @param values JSON array of path/value objects
+   */
+  void append_context(const String& context, const String& values);
   bool data_available();
+  /**
+   * Moves the buffered values into a delta message. Values of the own
+   * vessel go first; each further call returns one queued context.
+   */
   void get_delta(String& output);
   void set_hostname(String hostname) { this->hostname = hostname; }
  private:
   String hostname;
   unsigned int max_buffer_size;
   std::list<String> buffer;
+  struct ContextUpdate {
+    String context;
+    String values;
+    uint64_t received;
+  };
+  std::list<ContextUpdate> context_buffer;
+  TimeSync* time_sync;
+  // monotonic time at which the first buffered value arrived
+  uint64_t batch_started = 0;
 };
 
 #endif
@@ -48,8 +48,8 @@ class SKOutput : public SKEmitter,
     return root;
   }
 
-  String get_config_schema() override {
-    return FPSTR(SIGNALKOUTPUT_SCHEMA);
+  PGM_P get_config_schema_P() override {
+    return SIGNALKOUTPUT_SCHEMA;
   }
 
   virtual bool set_configuration(const JsonObject& config) override {
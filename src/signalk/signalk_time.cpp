@@ -22,20 +22,18 @@ String SKOutputTime::as_signalK() {
 JsonObject& SKOutputTime::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["sk_path"] = sk_path;
-  root["value"] = output;
   return root;
 }
 
 static const char SCHEMA[] PROGMEM = R"({
     "type": "object",
     "properties": {
-        "sk_path": { "title": "SignalK Path", "type": "string" },
-        "value": { "title": "Last value", "type" : "string", "readOnly": true }
+        "sk_path": { "title": "SignalK Path", "type": "string" }
     }
   })";
 
-String SKOutputTime::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P SKOutputTime::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool SKOutputTime::set_configuration(const JsonObject& config) {
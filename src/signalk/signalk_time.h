@@ -11,7 +11,7 @@ class SKOutputTime : public TimeString,
   virtual String as_signalK() override;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 };
 
 #endif
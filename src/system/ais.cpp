@@ -0,0 +1,547 @@
+#include "ais.h"
+
+#include "sensesp.h"
+
+// Values that mark a field as not available
+#define AIS_LON_NOT_AVAILABLE (181 * 600000)
+#define AIS_LAT_NOT_AVAILABLE (91 * 600000)
+#define AIS_SOG_NOT_AVAILABLE 1023
+#define AIS_COG_NOT_AVAILABLE 3600
+#define AIS_HEADING_NOT_AVAILABLE 511
+
+// Auxiliary craft (98XXXYYYY) report their mothership instead of their
+// dimensions in type 24 messages
+#define AIS_IS_AUXILIARY_CRAFT(mmsi) ((mmsi) / 10000000 == 98)
+
+#define AIS_KNOTS_TO_MS (1852.0 / 3600.0)
+
+// Signal K navigation.state for each AIS navigational status, nullptr
+// for the reserved and "not defined" ones
+static const char* const navigation_states[16] = {
+    "motoring",
+    "anchored",
+    "not under command",
+    "restricted manouverability",
+    "constrained by draft",
+    "moored",
+    "aground",
+    "fishing",
+    "sailing",
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    "ais-sart",
+    nullptr};
+
+static inline uint8_t dearmor(char c) {
+  uint8_t v = c - 48;
+  return v > 40 ? v - 8 : v;
+}
+
+AISBitReader::AISBitReader(const char* payload, size_t length, int fill_bits)
+    : payload{payload}, payload_end{payload + length} {
+  num_bits = length * 6;
+  num_bits = fill_bits < (int)num_bits ? num_bits - fill_bits : 0;
+}
+
+uint32_t AISBitReader::read_uint(int bits) {
+  while (accumulated_bits < bits) {
+    uint8_t v = payload < payload_end ? dearmor(*payload++) : 0;
+    accumulator = (accumulator << 6) | (v & 0x3f);
+    accumulated_bits += 6;
+  }
+  accumulated_bits -= bits;
+  return (accumulator >> accumulated_bits) & ((1ULL << bits) - 1);
+}
+
+int32_t AISBitReader::read_int(int bits) {
+  uint32_t value = read_uint(bits);
+  // sign extend
+  uint32_t sign = 1UL << (bits - 1);
+  return (int32_t)((value ^ sign) - sign);
+}
+
+void AISBitReader::skip(int bits) {
+  for (; bits > 30; bits -= 30) {
+    read_uint(30);
+  }
+  read_uint(bits);
+}
+
+void AISBitReader::read_string(char* buf, int chars) {
+  int len = 0;
+  for (int i = 0; i < chars; i++) {
+    uint8_t v = read_uint(6);
+    // 0-31 map to '@'-'_', 32-63 to ' '-'?'
+    buf[i] = v < 32 ? v + 64 : v;
+    if (buf[i] != '@' && buf[i] != ' ') {
+      len = i + 1;
+    }
+  }
+  // '@' is padding; the name ends with it or with spaces
+  for (int i = 0; i < len; i++) {
+    if (buf[i] == '@') {
+      len = i;
+    }
+  }
+  buf[len] = 0;
+}
+
+// Helpers for building the array of delta values
+
+static void begin_value(String& values, const char* path) {
+  if (values.length() > 1) {
+    values += ',';
+  }
+  values += "{\"path\":\"";
+  values += path;
+  values += "\",\"value\":";
+}
+
+static void append_number(String& values, double value, int decimals) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, value);
+  values += buf;
+}
+
+static void append_string(String& values, const char* str) {
+  values += '"';
+  for (const char* p = str; *p != 0; p++) {
+    // the six-bit character set includes both of these
+    if (*p == '"' || *p == '\\') {
+      values += '\\';
+    }
+    values += *p;
+  }
+  values += '"';
+}
+
+static void add_number(String& values, const char* path, double value,
+                       int decimals) {
+  begin_value(values, path);
+  append_number(values, value, decimals);
+  values += '}';
+}
+
+static void add_string(String& values, const char* path, const char* str) {
+  begin_value(values, path);
+  append_string(values, str);
+  values += '}';
+}
+
+AISDecoder::AISDecoder(
+    std::function<void(const String&, const String&)> publish)
+    : publish{publish} {
+  values.reserve(512);
+}
+
+AISTarget* AISDecoder::get_target(uint32_t mmsi) {
+  AISTarget* oldest = nullptr;
+  uint32_t now = millis();
+  for (int i = 0; i < num_targets; i++) {
+    AISTarget* target = &targets[i];
+    if (target->mmsi == mmsi) {
+      target->last_seen = now;
+      return target;
+    }
+    if (oldest == nullptr ||
+        now - target->last_seen > now - oldest->last_seen) {
+      oldest = target;
+    }
+  }
+  AISTarget* target = num_targets < AIS_MAX_TARGETS ? &targets[num_targets++]
+                                                    : oldest;
+  target->mmsi = mmsi;
+  target->last_seen = now;
+  target->last_position = 0;
+  target->last_static = 0;
+  target->last_static_b = 0;
+  target->seen_position = false;
+  target->seen_static = false;
+  target->seen_static_b = false;
+  return target;
+}
+
+bool AISDecoder::is_due(uint32_t* last, bool* seen, uint32_t interval) {
+  uint32_t now = millis();
+  if (*seen && now - *last < interval) {
+    messages_limited++;
+    return false;
+  }
+  *last = now;
+  *seen = true;
+  return true;
+}
+
+void AISDecoder::decode(const char* payload, size_t length, int fill_bits) {
+  AISBitReader reader(payload, length, fill_bits);
+  uint32_t type = reader.read_uint(6);
+  // repeat indicator
+  reader.skip(2);
+  uint32_t mmsi = reader.read_uint(30);
+  if (mmsi == 0) {
+    return;
+  }
+
+  size_t min_bits;
+  switch (type) {
+    case 1:
+    case 2:
+    case 3:
+    case 18:
+      min_bits = 168;
+      break;
+    case 5:
+      // often sent without the last two spare bits
+      min_bits = 420;
+      break;
+    case 19:
+      min_bits = 312;
+      break;
+    case 24:
+      // part A is 160 bits, part B 168
+      min_bits = 160;
+      break;
+    default:
+      return;
+  }
+  if (reader.size() < min_bits) {
+    debugD("AIS message type %d too short: %d bits", type, reader.size());
+    return;
+  }
+
+  AISTarget* target = get_target(mmsi);
+  values = "[";
+  switch (type) {
+    case 1:
+    case 2:
+    case 3:
+      if (!is_due(&target->last_position, &target->seen_position,
+                  position_interval)) {
+        return;
+      }
+      decode_class_a_position(reader);
+      break;
+    case 5:
+      if (!is_due(&target->last_static, &target->seen_static,
+                  static_interval)) {
+        return;
+      }
+      decode_static_voyage(reader, mmsi);
+      break;
+    case 18:
+    case 19:
+      decode_class_b_position(reader, target, type == 19);
+      break;
+    case 24:
+      decode_static_data(reader, target);
+      break;
+  }
+  if (values.length() <= 1) {
+    return;
+  }
+  values += ']';
+  messages_decoded++;
+
+  char context[40];
+  snprintf(context, sizeof(context), "vessels.urn:mrn:imo:mmsi:%09u",
+           (unsigned)mmsi);
+  publish(context, values);
+}
+
+void AISDecoder::add_position(int32_t lon, int32_t lat, uint32_t sog,
+                              uint32_t cog, uint32_t heading) {
+  if (lon != AIS_LON_NOT_AVAILABLE && lat != AIS_LAT_NOT_AVAILABLE) {
+    begin_value(values, "navigation.position");
+    values += "{\"longitude\":";
+    append_number(values, lon / 600000.0, 7);
+    values += ",\"latitude\":";
+    append_number(values, lat / 600000.0, 7);
+    values += "}}";
+  }
+  if (sog != AIS_SOG_NOT_AVAILABLE) {
+    add_number(values, "navigation.speedOverGround",
+               sog * 0.1 * AIS_KNOTS_TO_MS, 2);
+  }
+  if (cog < AIS_COG_NOT_AVAILABLE) {
+    add_number(values, "navigation.courseOverGroundTrue",
+               cog * 0.1 * DEG_TO_RAD, 4);
+  }
+  if (heading != AIS_HEADING_NOT_AVAILABLE && heading < 360) {
+    add_number(values, "navigation.headingTrue", heading * DEG_TO_RAD, 4);
+  }
+}
+
+void AISDecoder::add_name(uint32_t mmsi, const char* name) {
+  // vessel properties without a path of their own
+  begin_value(values, "");
+  char mmsi_str[10];
+  snprintf(mmsi_str, sizeof(mmsi_str), "%09u", (unsigned)mmsi);
+  values += "{\"mmsi\":\"";
+  values += mmsi_str;
+  values += '"';
+  if (name[0] != 0) {
+    values += ",\"name\":";
+    append_string(values, name);
+  }
+  values += "}}";
+}
+
+void AISDecoder::add_ship_type(uint32_t ship_type) {
+  if (ship_type != 0) {
+    begin_value(values, "design.aisShipType");
+    values += "{\"id\":";
+    values += ship_type;
+    values += "}}";
+  }
+}
+
+void AISDecoder::add_dimensions(uint32_t to_bow, uint32_t to_stern,
+                                uint32_t to_port, uint32_t to_starboard) {
+  if (to_bow + to_stern > 0) {
+    begin_value(values, "design.length");
+    values += "{\"overall\":";
+    values += to_bow + to_stern;
+    values += '}';
+    values += '}';
+    add_number(values, "sensors.ais.fromBow", to_bow, 0);
+  }
+  if (to_port + to_starboard > 0) {
+    add_number(values, "design.beam", to_port + to_starboard, 0);
+    // positive to starboard
+    add_number(values, "sensors.ais.fromCenter",
+               ((float)to_port - (float)to_starboard) / 2, 1);
+  }
+}
+
+void AISDecoder::decode_class_a_position(AISBitReader& reader) {
+  uint32_t status = reader.read_uint(4);
+  // rate of turn
+  reader.skip(8);
+  uint32_t sog = reader.read_uint(10);
+  // position accuracy
+  reader.skip(1);
+  int32_t lon = reader.read_int(28);
+  int32_t lat = reader.read_int(27);
+  uint32_t cog = reader.read_uint(12);
+  uint32_t heading = reader.read_uint(9);
+
+  add_position(lon, lat, sog, cog, heading);
+  if (navigation_states[status] != nullptr) {
+    add_string(values, "navigation.state", navigation_states[status]);
+  }
+}
+
+void AISDecoder::decode_static_voyage(AISBitReader& reader, uint32_t mmsi) {
+  char str[21];
+  // AIS version
+  reader.skip(2);
+  uint32_t imo = reader.read_uint(30);
+  reader.read_string(str, 7);
+  if (str[0] != 0) {
+    add_string(values, "communication.callsignVhf", str);
+  }
+  reader.read_string(str, 20);
+  add_name(mmsi, str);
+  if (imo != 0) {
+    char imo_str[16];
+    snprintf(imo_str, sizeof(imo_str), "IMO %u", (unsigned)imo);
+    add_string(values, "registrations.imo", imo_str);
+  }
+  add_ship_type(reader.read_uint(8));
+  uint32_t to_bow = reader.read_uint(9);
+  uint32_t to_stern = reader.read_uint(9);
+  uint32_t to_port = reader.read_uint(6);
+  uint32_t to_starboard = reader.read_uint(6);
+  add_dimensions(to_bow, to_stern, to_port, to_starboard);
+  // position fix type and ETA
+  reader.skip(4 + 20);
+  uint32_t draught = reader.read_uint(8);
+  if (draught != 0) {
+    begin_value(values, "design.draft");
+    values += "{\"current\":";
+    append_number(values, draught * 0.1, 1);
+    values += "}}";
+  }
+  reader.read_string(str, 20);
+  if (str[0] != 0) {
+    add_string(values, "navigation.destination.commonName", str);
+  }
+}
+
+void AISDecoder::decode_class_b_position(AISBitReader& reader,
+                                         AISTarget* target, bool extended) {
+  // reserved
+  reader.skip(8);
+  uint32_t sog = reader.read_uint(10);
+  // position accuracy
+  reader.skip(1);
+  int32_t lon = reader.read_int(28);
+  int32_t lat = reader.read_int(27);
+  uint32_t cog = reader.read_uint(12);
+  uint32_t heading = reader.read_uint(9);
+  if (is_due(&target->last_position, &target->seen_position,
+             position_interval)) {
+    add_position(lon, lat, sog, cog, heading);
+  }
+  if (!extended ||
+      !is_due(&target->last_static, &target->seen_static, static_interval)) {
+    return;
+  }
+  // time stamp and regional reserved
+  reader.skip(6 + 4);
+  char name[21];
+  reader.read_string(name, 20);
+  add_name(target->mmsi, name);
+  add_ship_type(reader.read_uint(8));
+  uint32_t to_bow = reader.read_uint(9);
+  uint32_t to_stern = reader.read_uint(9);
+  uint32_t to_port = reader.read_uint(6);
+  uint32_t to_starboard = reader.read_uint(6);
+  add_dimensions(to_bow, to_stern, to_port, to_starboard);
+}
+
+void AISDecoder::decode_static_data(AISBitReader& reader, AISTarget* target) {
+  uint32_t part = reader.read_uint(2);
+  char str[21];
+  if (part == 0) {
+    if (!is_due(&target->last_static, &target->seen_static,
+                static_interval)) {
+      return;
+    }
+    reader.read_string(str, 20);
+    add_name(target->mmsi, str);
+  } else if (part == 1) {
+    if (reader.size() < 168 ||
+        !is_due(&target->last_static_b, &target->seen_static_b,
+                static_interval)) {
+      return;
+    }
+    add_ship_type(reader.read_uint(8));
+    // vendor id
+    reader.skip(42);
+    reader.read_string(str, 7);
+    if (str[0] != 0) {
+      add_string(values, "communication.callsignVhf", str);
+    }
+    if (!AIS_IS_AUXILIARY_CRAFT(target->mmsi)) {
+      uint32_t to_bow = reader.read_uint(9);
+      uint32_t to_stern = reader.read_uint(9);
+      uint32_t to_port = reader.read_uint(6);
+      uint32_t to_starboard = reader.read_uint(6);
+      add_dimensions(to_bow, to_stern, to_port, to_starboard);
+    }
+  }
+}
+
+VDMSentenceParser::VDMSentenceParser(AISDecoder* decoder, const char* sentence)
+    : SentenceParser{nullptr}, decoder{decoder}, sentence_{sentence} {
+  for (int i = 0; i < AIS_MAX_PENDING_MESSAGES; i++) {
+    pending[i].sequence_id = 0;
+  }
+}
+
+// Parses a field of a single digit
+static bool parse_digit(const char* s, int* value) {
+  if (s[0] < '0' || s[0] > '9' || s[1] != 0) {
+    return false;
+  }
+  *value = s[0] - '0';
+  return true;
+}
+
+bool VDMSentenceParser::parse(char* buffer, int term_offsets[],
+                              int num_terms) {
+  // !AIVDM,<fragments>,<fragment>,<message id>,<channel>,<payload>,<fill>*hh
+  if (num_terms < 8) {
+    debugD("VDM: too few terms");
+    return false;
+  }
+  int num_fragments;
+  int fragment;
+  int fill_bits;
+  if (!parse_digit(buffer + term_offsets[1], &num_fragments) ||
+      !parse_digit(buffer + term_offsets[2], &fragment) ||
+      !parse_digit(buffer + term_offsets[6], &fill_bits) ||
+      num_fragments < 1 || fragment < 1 || fragment > num_fragments ||
+      fill_bits > 5) {
+    debugD("VDM: invalid fragment");
+    return false;
+  }
+  const char* payload = buffer + term_offsets[5];
+  size_t length = term_offsets[6] - term_offsets[5] - 1;
+
+  if (num_fragments == 1) {
+    decoder->decode(payload, length, fill_bits);
+    return true;
+  }
+
+  // a missing message id is allowed in theory, but would make
+  // interleaved messages impossible to tell apart
+  char sequence_id = buffer[term_offsets[3]];
+  if (sequence_id == 0) {
+    sequence_id = '-';
+  }
+  char channel = buffer[term_offsets[4]];
+  uint32_t now = millis();
+
+  PendingMessage* message = nullptr;
+  if (fragment == 1) {
+    // take a free slot, or the one waiting the longest
+    for (int i = 0; i < AIS_MAX_PENDING_MESSAGES; i++) {
+      PendingMessage* candidate = &pending[i];
+      if (candidate->sequence_id == 0 ||
+          (candidate->sequence_id == sequence_id &&
+           candidate->channel == channel)) {
+        message = candidate;
+        break;
+      }
+      if (message == nullptr ||
+          now - candidate->started > now - message->started) {
+        message = candidate;
+      }
+    }
+    message->sequence_id = sequence_id;
+    message->channel = channel;
+    message->num_fragments = num_fragments;
+    message->next_fragment = 1;
+    message->started = now;
+    message->length = 0;
+  } else {
+    for (int i = 0; i < AIS_MAX_PENDING_MESSAGES; i++) {
+      PendingMessage* candidate = &pending[i];
+      if (candidate->sequence_id == sequence_id &&
+          candidate->channel == channel) {
+        message = candidate;
+        break;
+      }
+    }
+    if (message == nullptr) {
+      return true;
+    }
+    if (message->next_fragment != fragment ||
+        message->num_fragments != num_fragments ||
+        now - message->started > AIS_FRAGMENT_TIMEOUT) {
+      // a fragment is missing
+      message->sequence_id = 0;
+      return true;
+    }
+  }
+
+  if (message->length + length > AIS_MAX_PAYLOAD) {
+    message->sequence_id = 0;
+    return false;
+  }
+  memcpy(message->payload + message->length, payload, length);
+  message->length += length;
+  message->next_fragment++;
+
+  if (fragment == num_fragments) {
+    // fill bits are only meaningful in the last fragment
+    decoder->decode(message->payload, message->length, fill_bits);
+    message->sequence_id = 0;
+  }
+  return true;
+}
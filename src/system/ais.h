@@ -0,0 +1,173 @@
+#ifndef _ais_H_
+#define _ais_H_
+
+#include <functional>
+
+#include "Arduino.h"
+#include "nmea_parser.h"
+
+// Armored payload characters of a reassembled message. Type 5 messages,
+// the longest ones commonly seen, take 71 characters in two sentences.
+#ifndef AIS_MAX_PAYLOAD
+#define AIS_MAX_PAYLOAD 168
+#endif
+
+// Multi-sentence messages that can be reassembled at the same time
+#ifndef AIS_MAX_PENDING_MESSAGES
+#define AIS_MAX_PENDING_MESSAGES 4
+#endif
+
+// Time (ms) after which an incomplete multi-sentence message is dropped
+#ifndef AIS_FRAGMENT_TIMEOUT
+#define AIS_FRAGMENT_TIMEOUT 2000
+#endif
+
+// Number of vessels for which update times are tracked. When the table
+// is full, the vessel that has been silent the longest is replaced.
+#ifndef AIS_MAX_TARGETS
+#define AIS_MAX_TARGETS 64
+#endif
+
+/**
+ * AISBitReader reads the fields of an AIS message directly from its
+ * armored payload, converting six bits at a time as they are needed.
+ * Reading past the end of the payload yields zero bits.
+ */
+class AISBitReader {
+ public:
+  AISBitReader(const char* payload, size_t length, int fill_bits = 0);
+
+  /// Returns the number of bits in the message
+  size_t size() { return num_bits; }
+  /// Reads an unsigned field of up to 32 bits
+  uint32_t read_uint(int bits);
+  /// Reads a two's complement field of up to 32 bits
+  int32_t read_int(int bits);
+  void skip(int bits);
+  /**
+   * Reads a field of six-bit characters, without the trailing '@'
+   * padding and spaces.
+   * @param buf Buffer of at least chars + 1 characters
+   */
+  void read_string(char* buf, int chars);
+
+ private:
+  const char* payload;
+  const char* payload_end;
+  size_t num_bits;
+  // de-armored bits that haven't been consumed yet
+  uint64_t accumulator = 0;
+  int accumulated_bits = 0;
+};
+
+/// Update times of one AIS target
+struct AISTarget {
+  uint32_t mmsi;
+  uint32_t last_seen;
+  // times at which the position and the static data were last published
+  uint32_t last_position;
+  uint32_t last_static;
+  // type 24 messages come in two parts that are limited separately
+  uint32_t last_static_b;
+  bool seen_position;
+  bool seen_static;
+  bool seen_static_b;
+};
+
+/**
+ * AISDecoder decodes the AIS messages that describe other vessels and
+ * passes their values on as Signal K delta values, together with the
+ * context of the vessel (vessels.urn:mrn:imo:mmsi:<mmsi>).
+ *
+ * Decoded message types:
+ * - 1, 2, 3 - Class A position report
+ * - 5 - Class A static and voyage related data
+ * - 18 - Class B position report
+ * - 19 - Extended class B position report
+ * - 24 - Class B static data report
+ *
+ * Position and static data of each vessel are published at most once
+ * per configured interval; anything received in between is dropped.
+ */
+class AISDecoder {
+ public:
+  /**
+   * @param publish Receives the context and a JSON array of the Signal K
+   * path/value objects for one vessel
+   */
+  AISDecoder(std::function<void(const String&, const String&)> publish);
+
+  /// Decodes a complete, armored AIS message
+  void decode(const char* payload, size_t length, int fill_bits);
+
+  /**
+   * Sets the shortest intervals (ms) at which the position and the
+   * static data of a vessel are published.
+   */
+  void set_intervals(uint32_t position_interval, uint32_t static_interval) {
+    this->position_interval = position_interval;
+    this->static_interval = static_interval;
+  }
+
+  uint32_t get_messages_decoded() { return messages_decoded; }
+  /// Messages dropped by the rate limiting
+  uint32_t get_messages_limited() { return messages_limited; }
+  int get_num_targets() { return num_targets; }
+
+ private:
+  std::function<void(const String&, const String&)> publish;
+  uint32_t position_interval = 5000;
+  uint32_t static_interval = 60000;
+  AISTarget targets[AIS_MAX_TARGETS];
+  int num_targets = 0;
+  uint32_t messages_decoded = 0;
+  uint32_t messages_limited = 0;
+  // reused for building the values, to avoid reallocating it
+  String values;
+
+  AISTarget* get_target(uint32_t mmsi);
+  bool is_due(uint32_t* last, bool* seen, uint32_t interval);
+  void decode_class_a_position(AISBitReader& reader);
+  void decode_static_voyage(AISBitReader& reader, uint32_t mmsi);
+  void decode_class_b_position(AISBitReader& reader, AISTarget* target,
+                               bool extended);
+  void decode_static_data(AISBitReader& reader, AISTarget* target);
+  void add_position(int32_t lon, int32_t lat, uint32_t sog, uint32_t cog,
+                    uint32_t heading);
+  void add_name(uint32_t mmsi, const char* name);
+  void add_ship_type(uint32_t ship_type);
+  void add_dimensions(uint32_t to_bow, uint32_t to_stern, uint32_t to_port,
+                      uint32_t to_starboard);
+};
+
+/**
+ * Reassembles the sentences of AIVDM (other vessels) or AIVDO (own
+ * vessel) messages and passes the complete messages to an AISDecoder.
+ */
+class VDMSentenceParser : public SentenceParser {
+ public:
+  /// @param sentence "VDM" or "VDO"
+  VDMSentenceParser(AISDecoder* decoder, const char* sentence = "VDM");
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return sentence_; }
+  // base stations and transponders are separate talkers
+  bool is_per_talker() override { return true; }
+
+ private:
+  struct PendingMessage {
+    // sequential message id, 0 if unused
+    char sequence_id;
+    char channel;
+    int num_fragments;
+    int next_fragment;
+    uint32_t started;
+    size_t length;
+    char payload[AIS_MAX_PAYLOAD];
+  };
+
+  AISDecoder* decoder;
+  const char* sentence_;
+  PendingMessage pending[AIS_MAX_PENDING_MESSAGES];
+};
+
+#endif
@@ -0,0 +1,405 @@
+#include "sensesp.h"
+
+#include "config_store.h"
+
+#include "system/configurable.h"
+
+#include <memory>
+#include <stdio.h>
+
+#include <ArduinoJson.h>
+
+#include "system/storage.h"
+#include "system/task_lock.h"
+
+// Store written without a header by earlier versions
+#define CONFIG_STORE_UNVERIFIED_PATH "/config.json"
+// Marks the header line of a copy of the store
+#define CONFIG_STORE_MAGIC "SKCFG"
+// Appended to the path of a damaged copy of the store set aside
+#define CONFIG_STORE_DAMAGED_SUFFIX ".bad"
+
+static const char* const slot_paths[] = {CONFIG_STORE_SLOT_A,
+                                         CONFIG_STORE_SLOT_B};
+
+ConfigStore config_store;
+
+// Guards the state that save() shares with other tasks; the web server
+// calls it from its callbacks
+static TaskMutex dirty_mutex;
+
+/// Computes the CRC-32 (IEEE 802.3) of everything printed to it
+class CRC32Print : public Print {
+ public:
+  size_t write(uint8_t c) override {
+    crc ^= c;
+    for (int i = 0; i < 8; i++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return 1;
+  }
+  using Print::write;
+  uint32_t get() { return ~crc; }
+
+ private:
+  uint32_t crc = 0xFFFFFFFF;
+};
+
+/// Parses the JSON object in a file of the given storage
+static JsonObject& read_object(Storage* from, const String& path,
+                               JsonBuffer& buf) {
+  auto f = from->open(path, "r");
+  if (!f) {
+    return JsonObject::invalid();
+  }
+  return buf.parseObject(*f);
+}
+
+bool ConfigStore::read(const String& config_path, String& json) {
+  load();
+  auto it = sections.find(config_path);
+  if (it == sections.end()) {
+    return false;
+  }
+  json = it->second;
+  if (claim_legacy_file(config_path)) {
+    // remove the file of the earlier version
+    request_flush();
+  }
+  return true;
+}
+
+void ConfigStore::save(Configurable* configurable) {
+  {
+    TaskLock lock(dirty_mutex);
+    dirty.insert(configurable);
+  }
+  request_flush();
+}
+
+void ConfigStore::request_flush() {
+  TaskLock lock(dirty_mutex);
+  if (flush_requested) {
+    return;
+  }
+  flush_requested = true;
+  flush_requested_at = millis();
+}
+
+void ConfigStore::import_legacy_from(Storage* legacy_storage) {
+  this->legacy_storage.reset(legacy_storage);
+}
+
+void ConfigStore::enable() {
+  app.onRepeat(CONFIG_STORE_POLL_INTERVAL, [this]() { this->poll(); });
+}
+
+void ConfigStore::poll() {
+  uint32_t requested_at;
+  {
+    TaskLock lock(dirty_mutex);
+    if (!flush_requested) {
+      return;
+    }
+    requested_at = flush_requested_at;
+  }
+  uint32_t now = millis();
+  if (now - requested_at < CONFIG_STORE_FLUSH_DELAY) {
+    return;
+  }
+  if (flushed && now - last_flush < CONFIG_STORE_MIN_FLUSH_INTERVAL) {
+    return;
+  }
+  flush();
+}
+
+void ConfigStore::flush() {
+  std::set<Configurable*> changed;
+  {
+    TaskLock lock(dirty_mutex);
+    flush_requested = false;
+    changed.swap(dirty);
+  }
+  if (changed.empty() && !legacy_claimed && !write_pending) {
+    return;
+  }
+  load();
+  for (auto* configurable : changed) {
+    claim_legacy_file(configurable->config_path);
+    DynamicJsonBuffer jsonBuffer;
+    JsonObject& obj = configurable->get_configuration(jsonBuffer);
+    String json;
+    obj.printTo(json);
+    sections[configurable->config_path] = json;
+  }
+  write_file();
+}
+
+void ConfigStore::clear() {
+  sections.clear();
+  {
+    TaskLock lock(dirty_mutex);
+    dirty.clear();
+  }
+  legacy_files.clear();
+  legacy_claimed = false;
+  legacy_storage.reset();
+  // don't import the files of a file system that is about to be formatted
+  loaded = true;
+}
+
+void ConfigStore::load() {
+  if (loaded) {
+    return;
+  }
+  if (storage == nullptr) {
+    // the file system isn't mounted yet
+    return;
+  }
+  loaded = true;
+  // only needed until the store has been loaded
+  std::unique_ptr<Storage> legacy(std::move(legacy_storage));
+
+  uint32_t sequences[2];
+  uint32_t crcs[2];
+  size_t lengths[2];
+  bool valid[2];
+  bool any_slot = false;
+  for (int slot = 0; slot < 2; slot++) {
+    valid[slot] = read_header(slot, &sequences[slot], &crcs[slot],
+                              &lengths[slot]);
+    any_slot |= storage->exists(slot_paths[slot]);
+  }
+  // try the newest copy first
+  int first = 0;
+  if (valid[1] && (!valid[0] || (int32_t)(sequences[1] - sequences[0]) > 0)) {
+    first = 1;
+  }
+  for (int i = 0; i < 2; i++) {
+    int slot = (first + i) % 2;
+    if (valid[slot] && load_slot(slot, crcs[slot], lengths[slot])) {
+      current_slot = slot;
+      sequence = sequences[slot];
+      debugI("Loaded the configuration of %d objects from %s",
+             sections.size(), slot_paths[slot]);
+      return;
+    }
+    if (storage->exists(slot_paths[slot])) {
+      debugE("The configuration store %s is damaged", slot_paths[slot]);
+    }
+  }
+  if (any_slot) {
+    set_aside_damaged(first);
+    // replace the damaged copies by whatever could be salvaged
+    write_file();
+    return;
+  }
+
+  // no store yet: import the configuration of earlier versions
+  Storage* from = legacy ? legacy.get() : storage;
+  if (load_unverified(from, CONFIG_STORE_UNVERIFIED_PATH)) {
+    // an earlier copy of the store itself, imported completely
+    legacy_files[CONFIG_STORE_UNVERIFIED_PATH] = true;
+    legacy_claimed = true;
+  } else {
+    std::vector<String> filenames;
+    from->list(
+        [&filenames](const String& path) { filenames.push_back(path); });
+    for (auto& filename : filenames) {
+      import_legacy_file(from, filename);
+    }
+  }
+  // write the store even if nothing was imported, so that this is done
+  // only once
+  write_file();
+}
+
+bool ConfigStore::read_header(int slot, uint32_t* sequence, uint32_t* crc,
+                              size_t* length) {
+  auto f = storage->open(slot_paths[slot], "r");
+  if (!f) {
+    return false;
+  }
+  String header = f->readStringUntil('\n');
+  size_t remaining = f->available();
+  f.reset();
+  unsigned int seq, len;
+  unsigned long checksum;
+  if (sscanf(header.c_str(), CONFIG_STORE_MAGIC " %u %lx %u", &seq,
+             &checksum, &len) != 3) {
+    return false;
+  }
+  // a copy cut short can be told by its size alone
+  if (remaining != len) {
+    return false;
+  }
+  *sequence = seq;
+  *crc = checksum;
+  *length = len;
+  return true;
+}
+
+bool ConfigStore::load_slot(int slot, uint32_t crc, size_t length) {
+  auto f = storage->open(slot_paths[slot], "r");
+  if (!f) {
+    return false;
+  }
+  f->readStringUntil('\n');
+  // parsed in place, without another copy
+  std::unique_ptr<char[]> buf(new char[length + 1]);
+  size_t read = f->readBytes(buf.get(), length);
+  f.reset();
+  if (read != length) {
+    return false;
+  }
+  CRC32Print crc32;
+  crc32.write((const uint8_t*)buf.get(), length);
+  if (crc32.get() != crc) {
+    return false;
+  }
+  buf[length] = 0;
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& root = jsonBuffer.parseObject(buf.get());
+  if (!root.success()) {
+    return false;
+  }
+  sections.clear();
+  for (auto kv : root) {
+    String json;
+    kv.value.as<JsonObject>().printTo(json);
+    sections[kv.key] = json;
+  }
+  return true;
+}
+
+void ConfigStore::set_aside_damaged(int first) {
+  bool salvaged = false;
+  for (int i = 0; i < 2; i++) {
+    int slot = (first + i) % 2;
+    if (!storage->exists(slot_paths[slot])) {
+      continue;
+    }
+    String damaged_path =
+        String(slot_paths[slot]) + CONFIG_STORE_DAMAGED_SUFFIX;
+    if (!storage->rename(slot_paths[slot], damaged_path)) {
+      debugE("Could not set aside %s", slot_paths[slot]);
+      damaged[slot] = true;
+      damaged_path = slot_paths[slot];
+    }
+    // a copy failing the check may still parse, e.g. if only a value or
+    // the header was damaged
+    if (!salvaged && load_unverified(storage, damaged_path, true)) {
+      debugW("Salvaged the configuration of %d objects from %s",
+             sections.size(), damaged_path.c_str());
+      salvaged = true;
+    }
+  }
+}
+
+bool ConfigStore::load_unverified(Storage* from, const String& path,
+                                  bool skip_header) {
+  DynamicJsonBuffer jsonBuffer;
+  auto f = from->open(path, "r");
+  if (!f) {
+    return false;
+  }
+  if (skip_header) {
+    f->readStringUntil('\n');
+  }
+  JsonObject& root = jsonBuffer.parseObject(*f);
+  f.reset();
+  if (!root.success()) {
+    return false;
+  }
+  for (auto kv : root) {
+    String json;
+    kv.value.as<JsonObject>().printTo(json);
+    sections[kv.key] = json;
+  }
+  return true;
+}
+
+void ConfigStore::import_legacy_file(Storage* from, const String& filename) {
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& obj = read_object(from, filename, jsonBuffer);
+  // configuration files hold a single JSON object; leave anything else
+  if (!obj.success()) {
+    return;
+  }
+  String json;
+  obj.printTo(json);
+  sections[filename] = json;
+  legacy_files[filename] = false;
+  debugI("Importing configuration file %s", filename.c_str());
+}
+
+bool ConfigStore::claim_legacy_file(const String& config_path) {
+  auto it = legacy_files.find(config_path);
+  if (it == legacy_files.end() || it->second) {
+    return false;
+  }
+  it->second = true;
+  legacy_claimed = true;
+  return true;
+}
+
+void ConfigStore::write_file() {
+  last_flush = millis();
+  flushed = true;
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& root = jsonBuffer.createObject();
+  for (auto& section : sections) {
+    root[section.first.c_str()] = RawJson(section.second.c_str());
+  }
+  CRC32Print crc32;
+  size_t length = root.printTo(crc32);
+
+  // never overwrite the current copy, nor a damaged one
+  int slot = current_slot == 0 ? 1 : 0;
+  if (damaged[slot]) {
+    slot = 1 - slot;
+  }
+  if (slot == current_slot || damaged[slot]) {
+    debugE("No slot left to write the configuration store to");
+    return;
+  }
+  auto f = storage->open(slot_paths[slot], "w");
+  if (!f) {
+    debugE("Could not write the configuration store");
+    retry_write();
+    return;
+  }
+  char header[48];
+  snprintf(header, sizeof(header), CONFIG_STORE_MAGIC " %u %08lx %u\n",
+           (unsigned int)(sequence + 1), (unsigned long)crc32.get(),
+           (unsigned int)length);
+  bool written = f->print(header) == strlen(header) &&
+                 root.printTo(*f) == length;
+  f.reset();
+  if (!written) {
+    debugE("Could not write the configuration store");
+    retry_write();
+    return;
+  }
+  write_pending = false;
+  current_slot = slot;
+  sequence++;
+
+  // files not claimed by a Configurable may belong to something else
+  for (auto it = legacy_files.begin(); it != legacy_files.end();) {
+    if (it->second) {
+      storage->remove(it->first);
+      it = legacy_files.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  legacy_claimed = false;
+}
+
+void ConfigStore::retry_write() {
+  // the changes are kept in sections; the dirty set has already been
+  // emptied, so that only the write itself is repeated
+  write_pending = true;
+  request_flush();
+}
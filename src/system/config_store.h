@@ -0,0 +1,139 @@
+#ifndef _config_store_H_
+#define _config_store_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "Arduino.h"
+
+// The two files holding the configuration of all Configurables. The
+// store is written to them in turn, so that the previous copy survives
+// an interrupted write.
+#ifndef CONFIG_STORE_SLOT_A
+#define CONFIG_STORE_SLOT_A "/config.a"
+#endif
+#ifndef CONFIG_STORE_SLOT_B
+#define CONFIG_STORE_SLOT_B "/config.b"
+#endif
+
+// Time (ms) after a change before the store is written, so that changes
+// made together are written at once
+#ifndef CONFIG_STORE_FLUSH_DELAY
+#define CONFIG_STORE_FLUSH_DELAY 1000
+#endif
+
+// Minimum time (ms) between two writes of the store, to limit the flash
+// wear of frequently saved values
+#ifndef CONFIG_STORE_MIN_FLUSH_INTERVAL
+#define CONFIG_STORE_MIN_FLUSH_INTERVAL 10000
+#endif
+
+// Interval (ms) at which the main loop checks for changes to write
+#ifndef CONFIG_STORE_POLL_INTERVAL
+#define CONFIG_STORE_POLL_INTERVAL 100
+#endif
+
+class Configurable;
+class Storage;
+
+/**
+ * ConfigStore keeps the saved configuration of all Configurables in a
+ * single store. The store is read once, on first use, into an index of
+ * the compact JSON of each config path; Configurables then load their
+ * configuration from RAM instead of opening a file of their own.
+ *
+ * Each copy of the store starts with a header line holding a sequence
+ * number, and the length and CRC-32 of the JSON that follows. Writes go
+ * to the slot not holding the current copy, and the newest copy that
+ * passes the check is loaded. A write cut short, e.g. by a brownout,
+ * thus falls back to the previous copy. Should both copies fail the
+ * check, they are renamed to e.g. "/config.a.bad" rather than written
+ * over, and whatever can still be parsed of the newest one is loaded.
+ *
+ * Saving is write-behind: save() only marks a Configurable as changed,
+ * and may be called from any task, e.g. from a web server callback.
+ * Once enabled, the main loop collects the configuration of all changed
+ * Configurables and writes it at once, at most every
+ * CONFIG_STORE_MIN_FLUSH_INTERVAL. A write that fails is retried after
+ * the same interval. Call flush() before restarting so that no change
+ * is lost.
+ *
+ * When the store file doesn't exist yet, the JSON files saved by
+ * earlier versions (one file per config path) are imported into it. A
+ * file is removed once a Configurable has loaded or saved its path and
+ * the store has been written; files no Configurable claims are left in
+ * place.
+ */
+class ConfigStore {
+ public:
+  /**
+   * Looks up the saved configuration of config_path.
+   * @return false if nothing has been saved for it
+   */
+  bool read(const String& config_path, String& json);
+  /**
+   * Schedules saving the configuration of a Configurable. It is
+   * retrieved with get_configuration() when the store is written.
+   */
+  void save(Configurable* configurable);
+  /// Starts writing the saved changes from the main loop
+  void enable();
+  /// Writes all pending changes now. Call from the main loop only.
+  void flush();
+  /// Forgets all configuration, e.g. before the file system is formatted
+  void clear();
+  /**
+   * Imports the configuration files of earlier versions from the given
+   * storage instead of the file system, e.g. from a copy in RAM that
+   * couldn't be written back. Takes ownership of the storage, which is
+   * deleted once the store has been loaded.
+   */
+  void import_legacy_from(Storage* legacy_storage);
+
+ private:
+  bool loaded = false;
+  std::map<String, String> sections;
+  // shared with the tasks calling save(); only accessed under the lock
+  std::set<Configurable*> dirty;
+  bool flush_requested = false;
+  uint32_t flush_requested_at = 0;
+
+  uint32_t last_flush = 0;
+  // the store has been written at least once since boot
+  bool flushed = false;
+  // the last write of the store failed and is to be retried
+  bool write_pending = false;
+  // imported files of earlier versions, by path; true once claimed by a
+  // Configurable, so that the file is removed after the next write
+  std::map<String, bool> legacy_files;
+  // some file of legacy_files is claimed
+  bool legacy_claimed = false;
+  // where to import legacy files from instead of the storage
+  std::unique_ptr<Storage> legacy_storage;
+  // slot of the current copy, -1 if there is none
+  int current_slot = -1;
+  // slots holding a damaged copy that couldn't be moved aside; they are
+  // never written
+  bool damaged[2] = {false, false};
+  uint32_t sequence = 0;
+
+  void load();
+  bool read_header(int slot, uint32_t* sequence, uint32_t* crc,
+                   size_t* length);
+  bool load_slot(int slot, uint32_t crc, size_t length);
+  void set_aside_damaged(int first);
+  bool load_unverified(Storage* from, const String& path,
+                       bool skip_header = false);
+  void import_legacy_file(Storage* from, const String& filename);
+  bool claim_legacy_file(const String& config_path);
+  void request_flush();
+  void poll();
+  void write_file();
+  void retry_write();
+};
+
+extern ConfigStore config_store;
+
+#endif
@@ -2,26 +2,68 @@
 
 #include "configurable.h"
 
-#ifdef ESP8266
-#include "FS.h"
-#elif defined(ESP32)
-#include "SPIFFS.h"
-#endif
+#include <algorithm>
 
-// Define a global configurable map. Rationale for a global variable:
+#include "system/config_store.h"
+
+// Define a global configurable registry. Rationale for a global variable:
 // Every Configurable with an id gets registered, and carrying an object
 // reference around would unnecessarily reduce readability of the code.
-std::map<String, Configurable*> configurables;
+ConfigurableRegistry configurables;
 
 Configurable::Configurable(String config_path="")
     : config_path{config_path} {
   if (config_path != "") {
-    auto it = configurables.find(config_path);
-    if (it != configurables.end()) {
-      debugW("WARNING: Overriding id %s", config_path.c_str());
+    configurables.add(this);
+  }
+}
+
+void ConfigurableRegistry::add(Configurable* configurable) {
+  entries.push_back({configurable->config_path.c_str(), configurable});
+  sorted = false;
+}
+
+void ConfigurableRegistry::build() {
+  if (sorted) {
+    return;
+  }
+  sorted = true;
+  // stable, so that of several Configurables with the same path, the
+  // one constructed last comes last
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return strcmp(a.path, b.path) < 0;
+                   });
+  auto last = entries.begin();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it != entries.begin() && strcmp(it->path, last->path) == 0) {
+      debugW("WARNING: Overriding id %s", it->path);
+      *last = *it;
+    } else if (it != entries.begin()) {
+      *++last = *it;
     }
-    configurables[config_path] = this;
   }
+  if (!entries.empty()) {
+    entries.erase(last + 1, entries.end());
+  }
+  entries.shrink_to_fit();
+}
+
+std::vector<ConfigurableRegistry::Entry>::iterator
+ConfigurableRegistry::lower_bound(const char* path) {
+  return std::lower_bound(entries.begin(), entries.end(), path,
+                          [](const Entry& entry, const char* path) {
+                            return strcmp(entry.path, path) < 0;
+                          });
+}
+
+Configurable* ConfigurableRegistry::find(const char* config_path) {
+  build();
+  auto it = lower_bound(config_path);
+  if (it == entries.end() || strcmp(it->path, config_path) != 0) {
+    return nullptr;
+  }
+  return it->configurable;
 }
 
 JsonObject& Configurable::get_configuration(JsonBuffer& buf) {
@@ -37,9 +79,38 @@ bool Configurable::set_configuration(const JsonObject& config) {
 
 
 String Configurable::get_config_schema() {
+  PGM_P schema = get_config_schema_P();
+  if (schema != nullptr) {
+    return FPSTR(schema);
+  }
   return "{}";
 }
 
+PGM_P Configurable::get_config_schema_P() {
+  return nullptr;
+}
+
+uint32_t Configurable::get_config_schema_id() {
+  if (schema_id == 0) {
+    // 32 bit FNV-1a
+    uint32_t hash = 2166136261;
+    PGM_P schema_P = get_config_schema_P();
+    if (schema_P != nullptr) {
+      uint8_t c;
+      while ((c = pgm_read_byte(schema_P++)) != 0) {
+        hash = (hash ^ c) * 16777619;
+      }
+    } else {
+      String schema = get_config_schema();
+      for (const char* p = schema.c_str(); *p != 0; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619;
+      }
+    }
+    schema_id = hash != 0 ? hash : 1;
+  }
+  return schema_id;
+}
+
 void Configurable::load_configuration() {
   if (config_path=="") {
     debugI(
@@ -47,36 +118,33 @@ void Configurable::load_configuration() {
       config_path.c_str());
     return;
   }
-  if (!SPIFFS.exists(config_path)) {
+  String json;
+  if (!config_store.read(config_path, json)) {
     debugI(
-      "Not loading configuration: file does not exist: %s",
+      "Not loading configuration: nothing saved for %s",
       config_path.c_str());
     return;
   }
 
-  File f = SPIFFS.open(config_path, "r");
   DynamicJsonBuffer jsonBuffer;
-  JsonObject& obj = jsonBuffer.parse(f);
+  JsonObject& obj = jsonBuffer.parseObject(json);
   if (!obj.success()) {
     debugW(
       "WARNING: Could not parse configuration for %s",
       config_path.c_str());
+    return;
   }
   if (!set_configuration(obj)) {
     debugW(
       "WARNING: Could not set configuration for %s",
       config_path.c_str());
   }
-  f.close();
 }
 
 void Configurable::save_configuration() {
   if (config_path=="") {
     debugI("WARNING: Could not save configuration (config_path not set)");
+    return;
   }
-  DynamicJsonBuffer jsonBuffer;
-  JsonObject& obj = get_configuration(jsonBuffer);
-  File f = SPIFFS.open(config_path, "w");
-  obj.printTo(f);
-  f.close();
+  config_store.save(this);
 }
@@ -1,7 +1,8 @@
 #ifndef _configurable_H_
 #define _configurable_H_
 
-#include <map>
+#include <string.h>
+#include <vector>
 
 #include "Arduino.h"
 #include <ArduinoJson.h>
@@ -56,9 +57,28 @@ class Configurable {
   virtual String get_config_schema();
 
 
+  /**
+   * Returns the config schema if it is a constant string in flash memory
+   * (PROGMEM), or nullptr if it isn't. Configurables with a constant
+   * schema override this instead of get_config_schema(), so that the
+   * schema is served straight from flash without a copy in RAM.
+   */
+  virtual PGM_P get_config_schema_P();
+
+
+  /**
+   * Returns an ID derived from the content of the config schema. The
+   * schema never changes at runtime, so the ID is computed only once.
+   * Configurables with identical schemas share the same ID, which lets
+   * the web UI cache each distinct schema once.
+   */
+  uint32_t get_config_schema_id();
+
+
   /**
    * Persists the configuration returned by get_configuration()
-   * to the local file system.
+   * to the local file system. The configuration is written shortly
+   * afterwards from the main loop, together with other changes.
    */
   virtual void save_configuration();
 
@@ -69,8 +89,62 @@ class Configurable {
    */
   virtual void load_configuration();
 
+ private:
+  // 0 until computed
+  uint32_t schema_id = 0;
+
  };
 
-extern std::map<String, Configurable*> configurables;
+/**
+ * The registry of all Configurables with a config_path. It is a vector
+ * sorted by config path, with the paths kept as const char* pointing
+ * into the Configurables. The Configurables are collected as they are
+ * constructed, and the vector is sorted once, on the first lookup after
+ * that (normally when SensESPApp is enabled).
+ */
+class ConfigurableRegistry {
+ public:
+  void add(Configurable* configurable);
+  /// Returns the Configurable of config_path, or nullptr if there is none
+  Configurable* find(const char* config_path);
+  /**
+   * Calls f for each Configurable whose config path starts with prefix,
+   * in the order of their paths. An empty prefix matches all of them.
+   */
+  template <typename F>
+  void for_each(const char* prefix, F f) {
+    build();
+    size_t length = strlen(prefix);
+    for (auto it = lower_bound(prefix); it != entries.end(); ++it) {
+      if (strncmp(it->path, prefix, length) != 0) {
+        break;
+      }
+      f(it->configurable);
+    }
+  }
+  size_t size() {
+    build();
+    return entries.size();
+  }
+  /// Returns the Configurable at a position in the order of the paths
+  Configurable* at(size_t index) {
+    build();
+    return entries[index].configurable;
+  }
+  /// Sorts the registry; done automatically on first use
+  void build();
+
+ private:
+  struct Entry {
+    const char* path;
+    Configurable* configurable;
+  };
+  std::vector<Entry> entries;
+  bool sorted = true;
+
+  std::vector<Entry>::iterator lower_bound(const char* path);
+};
+
+extern ConfigurableRegistry configurables;
 
 #endif
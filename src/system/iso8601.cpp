@@ -0,0 +1,145 @@
+#include "iso8601.h"
+
+// Date conversions from Howard Hinnant's "chrono-Compatible Low-Level
+// Date Algorithms", valid for the whole proleptic Gregorian calendar.
+
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void civil_from_days(int64_t z, int64_t* y, unsigned* m, unsigned* d) {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  *d = doy - (153 * mp + 2) / 5 + 1;
+  *m = mp < 10 ? mp + 3 : mp - 9;
+  *y = (int64_t)yoe + era * 400 + (*m <= 2);
+}
+
+static char* put_digits(char* p, unsigned value, int digits) {
+  for (int i = digits - 1; i >= 0; i--) {
+    p[i] = '0' + value % 10;
+    value /= 10;
+  }
+  return p + digits;
+}
+
+size_t format_iso8601(char* buf, int64_t utc_ms, bool with_millis) {
+  int64_t days = utc_ms / 86400000;
+  int64_t ms_of_day = utc_ms % 86400000;
+  if (ms_of_day < 0) {
+    ms_of_day += 86400000;
+    days--;
+  }
+  int64_t year;
+  unsigned month;
+  unsigned day;
+  civil_from_days(days, &year, &month, &day);
+  unsigned ms = ms_of_day;
+
+  char* p = buf;
+  p = put_digits(p, year, 4);
+  *p++ = '-';
+  p = put_digits(p, month, 2);
+  *p++ = '-';
+  p = put_digits(p, day, 2);
+  *p++ = 'T';
+  p = put_digits(p, ms / 3600000, 2);
+  *p++ = ':';
+  p = put_digits(p, ms / 60000 % 60, 2);
+  *p++ = ':';
+  p = put_digits(p, ms / 1000 % 60, 2);
+  if (with_millis) {
+    *p++ = '.';
+    p = put_digits(p, ms % 1000, 3);
+  }
+  *p++ = 'Z';
+  *p = 0;
+  return p - buf;
+}
+
+// Parses exactly the given number of digits
+static bool get_digits(const char*& p, int digits, unsigned* value) {
+  *value = 0;
+  for (int i = 0; i < digits; i++, p++) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    *value = *value * 10 + (*p - '0');
+  }
+  return true;
+}
+
+static bool expect(const char*& p, char c) {
+  if (*p != c) {
+    return false;
+  }
+  p++;
+  return true;
+}
+
+bool parse_iso8601(const char* str, int64_t* utc_ms) {
+  const char* p = str;
+  unsigned year, month, day, hour, minute, second;
+  if (!get_digits(p, 4, &year) || !expect(p, '-') ||
+      !get_digits(p, 2, &month) || !expect(p, '-') ||
+      !get_digits(p, 2, &day) || !expect(p, 'T') ||
+      !get_digits(p, 2, &hour) || !expect(p, ':') ||
+      !get_digits(p, 2, &minute) || !expect(p, ':') ||
+      !get_digits(p, 2, &second)) {
+    return false;
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 ||
+      minute > 59 || second > 60) {
+    return false;
+  }
+
+  unsigned ms = 0;
+  if (*p == '.') {
+    p++;
+    unsigned scale = 100;
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    for (; *p >= '0' && *p <= '9'; p++) {
+      ms += (*p - '0') * scale;
+      scale /= 10;
+    }
+  }
+
+  int32_t offset_minutes = 0;
+  if (*p == '+' || *p == '-') {
+    int sign = *p++ == '-' ? -1 : 1;
+    unsigned offset_hours;
+    unsigned offset_mins = 0;
+    if (!get_digits(p, 2, &offset_hours)) {
+      return false;
+    }
+    if (*p == ':') {
+      p++;
+    }
+    if (*p != 0 && !get_digits(p, 2, &offset_mins)) {
+      return false;
+    }
+    offset_minutes = sign * (int32_t)(offset_hours * 60 + offset_mins);
+  } else if (*p == 'Z') {
+    p++;
+  }
+  if (*p != 0) {
+    return false;
+  }
+
+  int64_t days = days_from_civil(year, month, day);
+  *utc_ms = days * 86400000 +
+            ((int64_t)hour * 3600 + minute * 60 + second) * 1000 + ms -
+            (int64_t)offset_minutes * 60000;
+  return true;
+}
@@ -0,0 +1,29 @@
+#ifndef _iso8601_H_
+#define _iso8601_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of a buffer for "2019-01-01T00:00:00.000Z", including the null
+constexpr size_t ISO8601_BUFFER_SIZE = 25;
+
+/**
+ * Formats a UTC time given in milliseconds since the epoch as an
+ * ISO 8601 string, e.g. "2019-01-01T00:00:00.000Z". The date is
+ * computed arithmetically, without gmtime() and strftime(), so it is
+ * cheap enough to call for every delta.
+ * @param buf Buffer of at least ISO8601_BUFFER_SIZE characters
+ * @param with_millis Include the milliseconds
+ * @return The number of characters written, excluding the null
+ */
+size_t format_iso8601(char* buf, int64_t utc_ms, bool with_millis = true);
+
+/**
+ * Parses an ISO 8601 date and time as sent by Signal K servers, with
+ * optional fractional seconds and an optional "Z" or numeric UTC
+ * offset.
+ * @return false if the string is not a valid timestamp
+ */
+bool parse_iso8601(const char* str, int64_t* utc_ms);
+
+#endif
@@ -0,0 +1,98 @@
+#include "sensesp.h"
+
+#include "live_values.h"
+
+#include <algorithm>
+
+LiveValueRegistry live_values;
+
+void LiveValueRegistry::add_entry(const char* id, void* producer,
+                                  Observable* observable, ToJson to_json) {
+  entries.push_back({id, producer, observable, to_json, 0});
+  sorted = false;
+  if (tracking) {
+    observe(entries.back());
+  }
+}
+
+void LiveValueRegistry::track_changes() {
+  if (tracking) {
+    return;
+  }
+  tracking = true;
+  for (auto& entry : entries) {
+    observe(entry);
+  }
+}
+
+void LiveValueRegistry::observe(const Entry& entry) {
+  // The entries move when the registry is sorted; look the entry up by
+  // its ID instead of keeping a pointer to it.
+  const char* id = entry.id;
+  entry.observable->attach([this, id]() {
+    auto it = this->lower_bound(id);
+    if (it != this->entries.end() && strcmp(it->id, id) == 0) {
+      it->changed = ++this->sequence;
+    }
+  });
+}
+
+void LiveValueRegistry::build() {
+  if (sorted) {
+    return;
+  }
+  sorted = true;
+  // stable, so that of several producers with the same ID, the one added
+  // last comes last and replaces the others
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const Entry& a, const Entry& b) {
+                     return strcmp(a.id, b.id) < 0;
+                   });
+  auto last = entries.begin();
+  for (auto it = entries.begin(); it != entries.end(); ++it) {
+    if (it != entries.begin() && strcmp(it->id, last->id) == 0) {
+      *last = *it;
+    } else if (it != entries.begin()) {
+      *++last = *it;
+    }
+  }
+  if (!entries.empty()) {
+    entries.erase(last + 1, entries.end());
+  }
+  entries.shrink_to_fit();
+}
+
+std::vector<LiveValueRegistry::Entry>::iterator
+LiveValueRegistry::lower_bound(const char* id) {
+  build();
+  return std::lower_bound(entries.begin(), entries.end(), id,
+                          [](const Entry& entry, const char* id) {
+                            return strcmp(entry.id, id) < 0;
+                          });
+}
+
+size_t LiveValueRegistry::get_values(const char* prefix, JsonObject& obj) {
+  return add_values(prefix, obj, false, 0);
+}
+
+size_t LiveValueRegistry::get_changed_values(const char* prefix,
+                                             JsonObject& obj,
+                                             uint32_t since) {
+  return add_values(prefix, obj, true, since);
+}
+
+size_t LiveValueRegistry::add_values(const char* prefix, JsonObject& obj,
+                                     bool changed_only, uint32_t since) {
+  size_t length = strlen(prefix);
+  size_t count = 0;
+  for (auto it = lower_bound(prefix);
+       it != entries.end() && strncmp(it->id, prefix, length) == 0; ++it) {
+    // the sequence number wraps around
+    if (changed_only && (int32_t)(it->changed - since) <= 0) {
+      continue;
+    }
+    it->to_json(it->producer, obj, it->id);
+    count++;
+  }
+  return count;
+}
@@ -0,0 +1,103 @@
+#ifndef _live_values_H_
+#define _live_values_H_
+
+#include <string.h>
+#include <vector>
+
+#include "Arduino.h"
+#include <ArduinoJson.h>
+
+#include "system/valueproducer.h"
+
+/**
+ * The registry of the current values of the ValueProducers, by ID. It
+ * lets the web UI read the live values of many producers at once without
+ * going through their configuration, and keeps the values out of the
+ * configuration that is saved to flash.
+ *
+ * Sensors and Transforms with a config_path are added automatically,
+ * with the config path as ID. Other producers can be added with add().
+ * Only producers of float, int, bool and String values are registered;
+ * add() ignores all others.
+ */
+class LiveValueRegistry {
+ public:
+  /**
+   * Adds a producer. id is kept as a pointer and must stay valid, e.g.
+   * a string literal or the config_path of the producer.
+   */
+  void add(const char* id, ValueProducer<float>* producer) {
+    add_entry(id, producer, producer, &value_to_json<float>);
+  }
+  void add(const char* id, ValueProducer<int>* producer) {
+    add_entry(id, producer, producer, &value_to_json<int>);
+  }
+  void add(const char* id, ValueProducer<bool>* producer) {
+    add_entry(id, producer, producer, &value_to_json<bool>);
+  }
+  void add(const char* id, ValueProducer<String>* producer) {
+    add_entry(id, producer, producer, &value_to_json<String>);
+  }
+  /// Values of other types have no JSON representation here
+  template <typename T>
+  void add(const char* id, ValueProducer<T>* producer) {}
+
+  /**
+   * Adds the current value of each producer whose ID starts with prefix
+   * to obj, with the ID as key. An empty prefix matches all of them.
+   * @return The number of values added
+   */
+  size_t get_values(const char* prefix, JsonObject& obj);
+  /**
+   * Like get_values(), but adds only the values that have changed since
+   * the registry had the sequence number since. Requires
+   * track_changes().
+   */
+  size_t get_changed_values(const char* prefix, JsonObject& obj,
+                            uint32_t since);
+  /**
+   * Starts recording which values change. Until this is called, the
+   * producers aren't observed, so that the registry costs nothing while
+   * nobody is watching the values.
+   */
+  void track_changes();
+  /// Increases each time a value changes
+  uint32_t get_sequence() { return sequence; }
+  size_t size() {
+    build();
+    return entries.size();
+  }
+  /// Sorts the registry; done automatically on first use
+  void build();
+
+ private:
+  typedef void (*ToJson)(void* producer, JsonObject& obj, const char* key);
+  struct Entry {
+    const char* id;
+    void* producer;
+    Observable* observable;
+    ToJson to_json;
+    // sequence number of the last change
+    uint32_t changed;
+  };
+  std::vector<Entry> entries;
+  bool sorted = true;
+  bool tracking = false;
+  uint32_t sequence = 0;
+
+  template <typename T>
+  static void value_to_json(void* producer, JsonObject& obj,
+                            const char* key) {
+    obj[key] = static_cast<ValueProducer<T>*>(producer)->get();
+  }
+  void add_entry(const char* id, void* producer, Observable* observable,
+                 ToJson to_json);
+  void observe(const Entry& entry);
+  std::vector<Entry>::iterator lower_bound(const char* id);
+  size_t add_values(const char* prefix, JsonObject& obj, bool changed_only,
+                    uint32_t since);
+};
+
+extern LiveValueRegistry live_values;
+
+#endif
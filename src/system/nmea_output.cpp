@@ -0,0 +1,373 @@
+#include "nmea_output.h"
+
+#include <algorithm>
+
+#include "sensesp.h"
+#include "system/iso8601.h"
+
+#define METERS_PER_FOOT 0.3048
+#define METERS_PER_FATHOM 1.8288
+
+static const uint32_t powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000,
+                                         1000000};
+
+void NMEASentenceBuilder::begin(const char* talker, const char* formatter) {
+  len = 0;
+  overflow = false;
+  put('$');
+  add_string(talker);
+  add_string(formatter);
+}
+
+void NMEASentenceBuilder::add_empty() { put(','); }
+
+void NMEASentenceBuilder::add_char(char c) {
+  put(',');
+  put(c);
+}
+
+void NMEASentenceBuilder::add_string(const char* str) {
+  for (const char* p = str; *p != 0; p++) {
+    put(*p);
+  }
+}
+
+void NMEASentenceBuilder::put_uint(uint32_t value, int min_digits) {
+  char digits[10];
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  for (; n < min_digits; min_digits--) {
+    put('0');
+  }
+  while (n > 0) {
+    put(digits[--n]);
+  }
+}
+
+void NMEASentenceBuilder::add_fixed(double value, int decimals) {
+  put(',');
+  double scaled = value * powers_of_ten[decimals];
+  bool negative = scaled < 0;
+  if (negative) {
+    scaled = -scaled;
+  }
+  // also catches NAN
+  if (!(scaled < 4e9)) {
+    return;
+  }
+  uint32_t rounded = (uint32_t)(scaled + 0.5);
+  if (negative && rounded != 0) {
+    put('-');
+  }
+  put_uint(rounded / powers_of_ten[decimals], 1);
+  if (decimals > 0) {
+    put('.');
+    put_uint(rounded % powers_of_ten[decimals], decimals);
+  }
+}
+
+void NMEASentenceBuilder::add_degrees(float radians, int decimals) {
+  float degrees = fmod(radians * RAD_TO_DEG, 360);
+  if (degrees < 0) {
+    degrees += 360;
+  }
+  add_fixed(degrees, decimals);
+}
+
+void NMEASentenceBuilder::add_latlon(double degrees, bool is_latitude) {
+  if (isnan(degrees)) {
+    put(',');
+    put(',');
+    return;
+  }
+  char hemisphere;
+  if (is_latitude) {
+    hemisphere = degrees < 0 ? 'S' : 'N';
+  } else {
+    hemisphere = degrees < 0 ? 'W' : 'E';
+  }
+  degrees = fabs(degrees);
+  uint32_t whole_degrees = (uint32_t)degrees;
+  // minutes with four decimals
+  uint32_t minutes = (uint32_t)((degrees - whole_degrees) * 600000 + 0.5);
+  if (minutes >= 600000) {
+    whole_degrees++;
+    minutes -= 600000;
+  }
+  put(',');
+  put_uint(whole_degrees, is_latitude ? 2 : 3);
+  put_uint(minutes / 10000, 2);
+  put('.');
+  put_uint(minutes % 10000, 4);
+  put(',');
+  put(hemisphere);
+}
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+bool NMEASentenceBuilder::finish() {
+  uint8_t checksum = 0;
+  for (size_t i = 1; i < len; i++) {
+    checksum ^= buf[i];
+  }
+  put('*');
+  put(hex_digits[checksum >> 4]);
+  put(hex_digits[checksum & 0xf]);
+  put('\r');
+  put('\n');
+  buf[len] = 0;
+  return !overflow;
+}
+
+void HDGSentence::set_input(float input, uint8_t input_channel) {
+  if (input_channel == 0) {
+    heading = input;
+    heading_updated = millis();
+  } else {
+    variation = input;
+    variation_updated = millis();
+  }
+}
+
+bool HDGSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(heading_updated)) {
+    return false;
+  }
+  builder.add_degrees(heading, 1);
+  // deviation is already included in the heading
+  builder.add_empty();
+  builder.add_empty();
+  if (is_fresh(variation_updated)) {
+    builder.add_fixed(fabs(variation * RAD_TO_DEG), 1);
+    builder.add_char(variation < 0 ? 'W' : 'E');
+  } else {
+    builder.add_empty();
+    builder.add_empty();
+  }
+  return true;
+}
+
+void HDMSentence::set_input(float input, uint8_t input_channel) {
+  heading = input;
+  updated = millis();
+}
+
+bool HDMSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(updated)) {
+    return false;
+  }
+  builder.add_degrees(heading, 1);
+  builder.add_char('M');
+  return true;
+}
+
+void DBTSentence::set_input(float input, uint8_t input_channel) {
+  depth = input;
+  updated = millis();
+}
+
+bool DBTSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(updated)) {
+    return false;
+  }
+  builder.add_fixed(depth / METERS_PER_FOOT, 1);
+  builder.add_char('f');
+  builder.add_fixed(depth, 1);
+  builder.add_char('M');
+  builder.add_fixed(depth / METERS_PER_FATHOM, 1);
+  builder.add_char('F');
+  return true;
+}
+
+void MWVSentence::set_input(float input, uint8_t input_channel) {
+  if (input_channel == 0) {
+    angle = input;
+    angle_updated = millis();
+  } else {
+    speed = input;
+    speed_updated = millis();
+  }
+}
+
+bool MWVSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(angle_updated) || !is_fresh(speed_updated)) {
+    return false;
+  }
+  builder.add_degrees(angle, 1);
+  builder.add_char(true_wind ? 'T' : 'R');
+  builder.add_fixed(speed, 1);
+  builder.add_char('M');
+  builder.add_char('A');
+  return true;
+}
+
+void RMCSentence::set_input(Position input, uint8_t input_channel) {
+  position = input;
+  position_updated = millis();
+}
+
+void RMCSentence::set_input(float input, uint8_t input_channel) {
+  if (input_channel == 0) {
+    speed = input;
+    speed_updated = millis();
+  } else {
+    course = input;
+    course_updated = millis();
+  }
+}
+
+bool RMCSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(position_updated)) {
+    return false;
+  }
+  // the ISO 8601 string has all the date and time digits needed
+  char iso[ISO8601_BUFFER_SIZE];
+  bool have_time = time_sync != nullptr && time_sync->is_synced();
+  if (have_time) {
+    format_iso8601(iso, time_sync->now());
+    // hhmmss.ss
+    char time[10] = {iso[11], iso[12], iso[14], iso[15], iso[17],
+                     iso[18], '.',     iso[20], iso[21], 0};
+    builder.add_empty();
+    builder.add_string(time);
+  } else {
+    builder.add_empty();
+  }
+  builder.add_char('A');
+  builder.add_latlon(position.latitude, true);
+  builder.add_latlon(position.longitude, false);
+  builder.add_fixed(
+      is_fresh(speed_updated) ? speed * 3600 / 1852 : NAN, 1);
+  if (is_fresh(course_updated)) {
+    builder.add_degrees(course, 1);
+  } else {
+    builder.add_empty();
+  }
+  builder.add_empty();
+  if (have_time) {
+    // ddmmyy
+    char date[7] = {iso[8], iso[9], iso[5], iso[6], iso[2], iso[3], 0};
+    builder.add_string(date);
+  }
+  // magnetic variation and its direction
+  builder.add_empty();
+  builder.add_empty();
+  // mode: autonomous
+  builder.add_char('A');
+  return true;
+}
+
+void XDRSentence::set_input(float input, uint8_t input_channel) {
+  value = input * multiplier + offset;
+  updated = millis();
+}
+
+bool XDRSentence::format(NMEASentenceBuilder& builder) {
+  if (!is_fresh(updated)) {
+    return false;
+  }
+  builder.add_char(type);
+  builder.add_fixed(value, 2);
+  builder.add_char(units);
+  builder.add_empty();
+  builder.add_string(name);
+  return true;
+}
+
+NMEAOutput::NMEAOutput(Stream* tx_stream, String config_path)
+    : Configurable{config_path}, tx_stream{tx_stream} {
+  load_configuration();
+}
+
+void NMEAOutput::add_sentence(NMEAOutputSentence* sentence) {
+  sentences.push_back(sentence);
+}
+
+void NMEAOutput::enable() {
+  last_refill = millis();
+  budget = NMEA_MAX_SENTENCE_LENGTH;
+  app.onRepeat(NMEA_OUTPUT_TICK, [this]() { this->send(); });
+}
+
+void NMEAOutput::send() {
+  uint32_t now = millis();
+  // ten bits per character on the line; allow a burst of two ticks, but
+  // at least one complete sentence
+  float chars_per_ms = baud_rate / 10000.0;
+  float max_budget =
+      max(chars_per_ms * 2 * NMEA_OUTPUT_TICK, (float)NMEA_MAX_SENTENCE_LENGTH);
+  budget = min(budget + (now - last_refill) * chars_per_ms, max_budget);
+  last_refill = now;
+
+  due.clear();
+  for (auto* sentence : sentences) {
+    if (!sentence->was_sent || now - sentence->last_sent >= sentence->interval) {
+      due.push_back(sentence);
+    }
+  }
+  // highest priority first, then the one that has waited the longest
+  std::sort(due.begin(), due.end(),
+            [now](NMEAOutputSentence* a, NMEAOutputSentence* b) {
+              if (a->priority != b->priority) {
+                return a->priority > b->priority;
+              }
+              return now - a->last_sent > now - b->last_sent;
+            });
+
+  for (auto* sentence : due) {
+    builder.begin(talker.c_str(), sentence->formatter);
+    if (!sentence->format(builder)) {
+      continue;
+    }
+    if (!builder.finish()) {
+      debugW("NMEA sentence %s too long", sentence->formatter);
+      continue;
+    }
+    if (builder.length() > budget) {
+      // keep the line for the sentences already waiting
+      sentences_deferred++;
+      break;
+    }
+    tx_stream->write((const uint8_t*)builder.c_str(), builder.length());
+    budget -= builder.length();
+    sentence->last_sent = now;
+    sentence->was_sent = true;
+    sentences_sent++;
+  }
+}
+
+JsonObject& NMEAOutput::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["talker"] = talker;
+  root["baud_rate"] = baud_rate;
+  return root;
+}
+
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "talker": { "title": "Talker ID", "type": "string", "description": "Two character talker ID of the sent sentences, e.g. II" },
+        "baud_rate": { "title": "Baud rate", "type": "integer", "description": "Baud rate of the serial port. The sentences are limited to what it can carry." }
+    }
+  })";
+
+PGM_P NMEAOutput::get_config_schema_P() { return SCHEMA; }
+
+bool NMEAOutput::set_configuration(const JsonObject& config) {
+  String expected[] = {"talker", "baud_rate"};
+  for (auto str : expected) {
+    if (!config.containsKey(str)) {
+      return false;
+    }
+  }
+  String talker = config["talker"].as<String>();
+  if (talker.length() != 2) {
+    return false;
+  }
+  this->talker = talker;
+  baud_rate = config["baud_rate"];
+  return true;
+}
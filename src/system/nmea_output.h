@@ -0,0 +1,273 @@
+#ifndef _nmea_output_H_
+#define _nmea_output_H_
+
+#include <vector>
+
+#include "Arduino.h"
+
+#include "system/configurable.h"
+#include "system/nmea_parser.h"
+#include "system/time_sync.h"
+#include "system/valueconsumer.h"
+
+// Longest NMEA 0183 sentence, including the '$' and the trailing CR LF
+#define NMEA_MAX_SENTENCE_LENGTH 82
+
+// Interval (ms) at which due sentences are sent
+#ifndef NMEA_OUTPUT_TICK
+#define NMEA_OUTPUT_TICK 50
+#endif
+
+// Inputs not updated for this long (ms) are considered lost, and the
+// sentences depending on them are no longer sent
+#ifndef NMEA_OUTPUT_MAX_AGE
+#define NMEA_OUTPUT_MAX_AGE 3000
+#endif
+
+/**
+ * Formats one NMEA 0183 sentence in a fixed buffer. Numbers are
+ * formatted with integer arithmetic instead of printf. Fields that are
+ * NAN are left empty.
+ */
+class NMEASentenceBuilder {
+ public:
+  /// Starts a sentence, e.g. with talker "II" and formatter "HDG"
+  void begin(const char* talker, const char* formatter);
+  void add_empty();
+  void add_char(char c);
+  void add_string(const char* str);
+  /// Adds a number with a fixed number of decimals (at most 6)
+  void add_fixed(double value, int decimals);
+  /// Adds an angle given in radians as degrees in the range [0, 360)
+  void add_degrees(float radians, int decimals);
+  /// Adds a latitude or longitude as ddmm.mmmm or dddmm.mmmm and N/S/E/W
+  void add_latlon(double degrees, bool is_latitude);
+  /**
+   * Appends the checksum and CR LF.
+   * @return false if the sentence didn't fit into NMEA_MAX_SENTENCE_LENGTH
+   */
+  bool finish();
+  const char* c_str() { return buf; }
+  size_t length() { return len; }
+
+ private:
+  char buf[NMEA_MAX_SENTENCE_LENGTH + 1];
+  size_t len = 0;
+  bool overflow = false;
+
+  void put(char c) {
+    if (len < NMEA_MAX_SENTENCE_LENGTH) {
+      buf[len++] = c;
+    } else {
+      overflow = true;
+    }
+  }
+  void put_uint(uint32_t value, int min_digits);
+};
+
+/**
+ * Base class of the sentences sent by NMEAOutput. Subclasses consume
+ * the values they need and format them when the sentence is due.
+ */
+class NMEAOutputSentence {
+ public:
+  /**
+   * @param formatter The sentence formatter, e.g. "HDG"
+   * @param interval Interval (ms) at which the sentence is sent
+   * @param priority Sentences with higher priority are sent first when
+   *   the line is saturated
+   */
+  NMEAOutputSentence(const char* formatter, uint32_t interval,
+                     uint8_t priority)
+      : formatter{formatter}, interval{interval}, priority{priority} {}
+
+  /**
+   * Adds the fields of the sentence to the builder.
+   * @return false if there's no current data to send
+   */
+  virtual bool format(NMEASentenceBuilder& builder) = 0;
+
+  const char* formatter;
+  uint32_t interval;
+  uint8_t priority;
+  // time at which the sentence was last sent, valid if was_sent
+  uint32_t last_sent = 0;
+  bool was_sent = false;
+
+ protected:
+  static bool is_fresh(uint32_t updated) {
+    return updated != 0 && millis() - updated < NMEA_OUTPUT_MAX_AGE;
+  }
+};
+
+/**
+ * HDG - Heading, deviation and variation. Input 0 is the magnetic
+ * heading and input 1 the magnetic variation, both in radians. The
+ * variation is optional.
+ */
+class HDGSentence : public NMEAOutputSentence, public ValueConsumer<float> {
+ public:
+  HDGSentence(uint32_t interval = 200, uint8_t priority = 3)
+      : NMEAOutputSentence{"HDG", interval, priority} {}
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  float heading = NAN;
+  float variation = NAN;
+  uint32_t heading_updated = 0;
+  uint32_t variation_updated = 0;
+};
+
+/// HDM - Heading, magnetic. The input is in radians.
+class HDMSentence : public NMEAOutputSentence, public ValueConsumer<float> {
+ public:
+  HDMSentence(uint32_t interval = 200, uint8_t priority = 3)
+      : NMEAOutputSentence{"HDM", interval, priority} {}
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  float heading = NAN;
+  uint32_t updated = 0;
+};
+
+/// DBT - Depth below transducer. The input is in meters.
+class DBTSentence : public NMEAOutputSentence, public ValueConsumer<float> {
+ public:
+  DBTSentence(uint32_t interval = 1000, uint8_t priority = 1)
+      : NMEAOutputSentence{"DBT", interval, priority} {}
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  float depth = NAN;
+  uint32_t updated = 0;
+};
+
+/**
+ * MWV - Wind speed and angle. Input 0 is the wind angle in radians and
+ * input 1 the wind speed in m/s.
+ */
+class MWVSentence : public NMEAOutputSentence, public ValueConsumer<float> {
+ public:
+  /// @param true_wind Send true instead of apparent wind
+  MWVSentence(bool true_wind = false, uint32_t interval = 500,
+              uint8_t priority = 2)
+      : NMEAOutputSentence{"MWV", interval, priority},
+        true_wind{true_wind} {}
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  bool true_wind;
+  float angle = NAN;
+  float speed = NAN;
+  uint32_t angle_updated = 0;
+  uint32_t speed_updated = 0;
+};
+
+/**
+ * RMC - Recommended minimum specific GNSS data. The position is
+ * required; the float inputs are the speed over ground in m/s (0) and
+ * the true course over ground in radians (1). The time is taken from
+ * the TimeSync, if given and synchronized.
+ */
+class RMCSentence : public NMEAOutputSentence,
+                    public ValueConsumer<Position>,
+                    public ValueConsumer<float> {
+ public:
+  RMCSentence(TimeSync* time_sync = nullptr, uint32_t interval = 1000,
+              uint8_t priority = 2)
+      : NMEAOutputSentence{"RMC", interval, priority},
+        time_sync{time_sync} {}
+  virtual void set_input(Position input, uint8_t input_channel = 0) override;
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  TimeSync* time_sync;
+  Position position;
+  float speed = NAN;
+  float course = NAN;
+  uint32_t position_updated = 0;
+  uint32_t speed_updated = 0;
+  uint32_t course_updated = 0;
+};
+
+/**
+ * XDR - Transducer measurement of a single transducer. The input is
+ * converted with multiplier and offset into the units of the sentence,
+ * e.g. from Kelvin to degrees Celsius with multiplier 1 and offset
+ * -273.15.
+ */
+class XDRSentence : public NMEAOutputSentence, public ValueConsumer<float> {
+ public:
+  /**
+   * @param type Transducer type, e.g. 'C' for temperature
+   * @param units Units of the measurement, e.g. 'C' for Celsius
+   * @param name Transducer name, e.g. "AirTemp"
+   */
+  XDRSentence(char type, char units, const char* name, float multiplier = 1,
+              float offset = 0, uint32_t interval = 2000,
+              uint8_t priority = 0)
+      : NMEAOutputSentence{"XDR", interval, priority},
+        type{type},
+        units{units},
+        name{name},
+        multiplier{multiplier},
+        offset{offset} {}
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+  bool format(NMEASentenceBuilder& builder) override;
+
+ private:
+  char type;
+  char units;
+  const char* name;
+  float multiplier;
+  float offset;
+  float value = NAN;
+  uint32_t updated = 0;
+};
+
+/**
+ * NMEAOutput sends NMEA 0183 sentences over a serial port, e.g. to an
+ * autopilot or a chart plotter. Every sentence is sent at its own
+ * interval as long as its inputs are current.
+ *
+ * The output is limited to what the configured baud rate can carry.
+ * When more sentences are due than fit on the line, the ones with the
+ * highest priority are sent first and the others wait until there is
+ * room again.
+ */
+class NMEAOutput : public Configurable {
+ public:
+  NMEAOutput(Stream* tx_stream, String config_path = "");
+  void add_sentence(NMEAOutputSentence* sentence);
+  void enable();
+
+  uint32_t get_sentences_sent() { return sentences_sent; }
+  /// Number of times a due sentence had to wait for the line
+  uint32_t get_sentences_deferred() { return sentences_deferred; }
+
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual PGM_P get_config_schema_P() override;
+
+ private:
+  Stream* tx_stream;
+  String talker = "II";
+  uint32_t baud_rate = 4800;
+  std::vector<NMEAOutputSentence*> sentences;
+  std::vector<NMEAOutputSentence*> due;
+  NMEASentenceBuilder builder;
+  // characters that may be sent before the line is saturated
+  float budget = 0;
+  uint32_t last_refill = 0;
+  uint32_t sentences_sent = 0;
+  uint32_t sentences_deferred = 0;
+
+  void send();
+};
+
+#endif
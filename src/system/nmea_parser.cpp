@@ -7,32 +7,39 @@
 #include <RemoteDebug.h>
 
 #include "sensesp.h"
-
-enum GNSSQuality {
-  no_gps,
-  gnss_fix,
-  dgnss_fix,
-  precise_gnss,
-  rtk_fixed_integer,
-  rtk_float,
-  estimated_mode,
-  manual_input,
-  simulator_mode,
-  error
+#include "system/live_values.h"
+
+static const char GNSS_QUALITY_NO_GPS[] PROGMEM = "no GPS";
+static const char GNSS_QUALITY_GNSS_FIX[] PROGMEM = "GNSS Fix";
+static const char GNSS_QUALITY_DGNSS_FIX[] PROGMEM = "DGNSS fix";
+static const char GNSS_QUALITY_PRECISE_GNSS[] PROGMEM = "Precise GNSS";
+static const char GNSS_QUALITY_RTK_FIXED[] PROGMEM = "RTK fixed integer";
+static const char GNSS_QUALITY_RTK_FLOAT[] PROGMEM = "RTK float";
+static const char GNSS_QUALITY_ESTIMATED[] PROGMEM = "Estimated (DR) mode";
+static const char GNSS_QUALITY_MANUAL[] PROGMEM = "Manual input";
+static const char GNSS_QUALITY_SIMULATOR[] PROGMEM = "Simulator mode";
+static const char GNSS_QUALITY_ERROR[] PROGMEM = "Error";
+
+static const char* const gnss_quality_names[] = {
+  GNSS_QUALITY_NO_GPS,
+  GNSS_QUALITY_GNSS_FIX,
+  GNSS_QUALITY_DGNSS_FIX,
+  GNSS_QUALITY_PRECISE_GNSS,
+  GNSS_QUALITY_RTK_FIXED,
+  GNSS_QUALITY_RTK_FLOAT,
+  GNSS_QUALITY_ESTIMATED,
+  GNSS_QUALITY_MANUAL,
+  GNSS_QUALITY_SIMULATOR,
+  GNSS_QUALITY_ERROR
 };
 
-String gnssQualityStrings[] = {
-  "no GPS",
-  "GNSS Fix",
-  "DGNSS fix",
-  "Precise GNSS",
-  "RTK fixed integer",
-  "RTK float",
-  "Estimated (DR) mode",
-  "Manual input",
-  "Simulator mode",
-  "Error"
-};
+const __FlashStringHelper* gnss_quality_name(GNSSQuality quality) {
+  int index = (int)quality;
+  if (index < (int)GNSSQuality::no_gps || index > (int)GNSSQuality::error) {
+    index = (int)GNSSQuality::error;
+  }
+  return FPSTR(gnss_quality_names[index]);
+}
 
 // reconstruct the original NMEA sentence for debugging purposes
 void reconstruct_nmea_sentence(
@@ -60,32 +67,131 @@ void reconstruct_nmea_sentence(
       sentence[term_offsets[num_terms-1]] = '*';
 }
 
-bool parse_int(int* value, char* s) {
-  int retval = sscanf(s, "%d", value);
-  return retval==1;
+// The field parsers below are hand-written instead of using sscanf:
+// they are locale-free, don't accept anything but plain decimal numbers
+// and are several times faster, which matters at 10 Hz output rates.
+// A field must consist of the number only; empty fields fail.
+
+// exact powers of ten, for scaling integer mantissas
+static const double powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+  1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+// Digits beyond this are ignored, as they exceed the mantissa anyway
+constexpr int MAX_MANTISSA_DIGITS = 18;
+
+// Parses an unsigned decimal number into an integer mantissa and the
+// number of its fractional digits. Returns the number of characters
+// consumed, or 0 if there were no digits.
+static int parse_decimal(uint64_t* mantissa, int* fraction_digits,
+                         const char* s) {
+  const char* p = s;
+  int digits = 0;
+  *mantissa = 0;
+  *fraction_digits = 0;
+  for (; *p >= '0' && *p <= '9'; p++) {
+    if (digits < MAX_MANTISSA_DIGITS) {
+      *mantissa = *mantissa * 10 + (*p - '0');
+      // leading zeros don't count against the mantissa size
+      digits += *mantissa != 0;
+    } else {
+      // far beyond any NMEA field
+      return 0;
+    }
+  }
+  bool has_digits = p != s;
+  if (*p == '.') {
+    p++;
+    for (; *p >= '0' && *p <= '9'; p++) {
+      // leading zeros of the fraction still scale the mantissa; stop at
+      // the size of the power of ten table as well
+      if (digits < MAX_MANTISSA_DIGITS &&
+          *fraction_digits < MAX_MANTISSA_DIGITS) {
+        *mantissa = *mantissa * 10 + (*p - '0');
+        digits += *mantissa != 0;
+        (*fraction_digits)++;
+      }
+      has_digits = true;
+    }
+  }
+  return has_digits ? p - s : 0;
 }
 
-bool parse_float(float* value, char* s) {
-  int retval = sscanf(s, "%f", value);
-  return retval==1;
+static double scale_decimal(uint64_t mantissa, int fraction_digits) {
+  if (fraction_digits > MAX_MANTISSA_DIGITS) {
+    fraction_digits = MAX_MANTISSA_DIGITS;
+  }
+  return mantissa / powers_of_ten[fraction_digits];
+}
+
+bool parse_int(int* value, char* s) {
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') {
+    s++;
+  }
+  if (*s < '0' || *s > '9') {
+    return false;
+  }
+  int result = 0;
+  for (; *s >= '0' && *s <= '9'; s++) {
+    result = result * 10 + (*s - '0');
+  }
+  if (*s != 0) {
+    return false;
+  }
+  *value = negative ? -result : result;
+  return true;
 }
 
 bool parse_double(double* value, char* s) {
-  int retval = sscanf(s, "%lf", value);
-  return retval==1;
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') {
+    s++;
+  }
+  uint64_t mantissa;
+  int fraction_digits;
+  int len = parse_decimal(&mantissa, &fraction_digits, s);
+  if (len == 0 || s[len] != 0) {
+    return false;
+  }
+  double result = scale_decimal(mantissa, fraction_digits);
+  *value = negative ? -result : result;
+  return true;
+}
+
+bool parse_float(float* value, char* s) {
+  double result;
+  if (!parse_double(&result, s)) {
+    return false;
+  }
+  *value = result;
+  return true;
 }
 
+// Parses a latitude or longitude in the NMEA format (d)ddmm.mmmm.
+// The minutes are kept as an integer mantissa until the final division,
+// so that no precision is lost to the degree/minute split.
 bool parse_latlon(double* value, char* s) {
-  double degmin;
-  int retval = sscanf(s, "%lf", &degmin);
-  if (retval==1) {
-    int degrees = degmin / 100;
-    double minutes = degmin - 100*degrees;
-    *value = degrees + minutes / 60;
-    return true;
-  } else {
+  uint64_t mantissa;
+  int fraction_digits;
+  int len = parse_decimal(&mantissa, &fraction_digits, s);
+  if (len == 0 || s[len] != 0) {
     return false;
   }
+  // keep 100 * scale within 64 bits
+  for (; fraction_digits > 16; fraction_digits--) {
+    mantissa /= 10;
+  }
+  uint64_t scale = 1;
+  for (int i = 0; i < fraction_digits; i++) {
+    scale *= 10;
+  }
+  // split at the hundreds of the integer part
+  uint64_t degrees = mantissa / (100 * scale);
+  uint64_t minutes = mantissa - degrees * 100 * scale;
+  *value = degrees + minutes / (60. * scale);
+  return true;
 }
 
 bool parse_NS(double* value, char* s) {
@@ -93,7 +199,7 @@ bool parse_NS(double* value, char* s) {
     case 'N':
       break;
     case 'S':
-      *value *= 1;
+      *value = -*value;
       break;
     default:
       return false;
@@ -106,7 +212,7 @@ bool parse_EW(double* value, char* s) {
     case 'E':
       break;
     case 'W':
-      *value *= 1;
+      *value = -*value;
       break;
     default:
       return false;
@@ -164,17 +270,29 @@ bool parse_PSTI030_mode(GNSSQuality* quality, char* s) {
   return true;
 }
 
+// Parses exactly two digits
+static bool parse_2_digits(int* value, const char* s) {
+  if (s[0] < '0' || s[0] > '9' || s[1] < '0' || s[1] > '9') {
+    return false;
+  }
+  *value = (s[0] - '0') * 10 + (s[1] - '0');
+  return true;
+}
+
 bool parse_time(int* hour, int* minute, float* second, char* s) {
-  int retval = sscanf(s, "%2d%2d%f", hour, minute, second);
-  return retval==3;
+  return parse_2_digits(hour, s) && parse_2_digits(minute, s + 2) &&
+         parse_float(second, s + 4);
 }
 
 bool parse_date(int* year, int* month, int* day, char* s) {
-  int retval = sscanf(s, "%2d%2d%2d", day, month, year);
+  if (!parse_2_digits(day, s) || !parse_2_digits(month, s + 2) ||
+      !parse_2_digits(year, s + 4) || s[6] != 0) {
+    return false;
+  }
   // date expressed as C struct tm
   *year += 100;
   *month -= 1;
-  return retval==3;
+  return true;
 }
 
 void report_success(bool ok, const char* sentence) {
@@ -186,7 +304,7 @@ void report_success(bool ok, const char* sentence) {
   }
 }
 
-void GPGGASentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+bool GGASentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
 
   int hour;
@@ -243,13 +361,18 @@ void GPGGASentenceParser::parse(char* buffer, int term_offsets[], int num_terms)
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
   // notify relevant observers
 
   nmea_data->position.set(position);
-  nmea_data->gnss_quality.set(gnssQualityStrings[quality]);
+  // GGA quality indicators beyond the known ones are reported as errors
+  if (quality < (int)GNSSQuality::no_gps ||
+      quality > (int)GNSSQuality::simulator_mode) {
+    quality = (int)GNSSQuality::error;
+  }
+  set_gnss_quality((GNSSQuality)quality);
   nmea_data->num_satellites.set(num_satellites);
   nmea_data->horizontal_dilution.set(horizontal_dilution);
   nmea_data->geoidal_separation.set(geoidal_separation);
@@ -259,9 +382,10 @@ void GPGGASentenceParser::parse(char* buffer, int term_offsets[], int num_terms)
   if (dgps_id_defined) {
     nmea_data->dgps_id.set(dgps_id);
   }
+  return true;
 }
 
-void GPGLLSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+bool GLLSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
 
   Position position;
@@ -278,7 +402,7 @@ void GPGLLSentenceParser::parse(char* buffer, int term_offsets[], int num_terms)
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
   position.altitude = -99999;
@@ -286,9 +410,10 @@ void GPGLLSentenceParser::parse(char* buffer, int term_offsets[], int num_terms)
   // notify relevant observers
 
   nmea_data->position.set(position);
+  return true;
 }
 
-void GPRMCSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+bool RMCSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
 
   struct tm time;
@@ -331,30 +456,260 @@ void GPRMCSentenceParser::parse(char* buffer, int term_offsets[], int num_terms)
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
   position.altitude = -99999;
-  time.tm_sec = (int)second;
-  time.tm_isdst = 0;
 
   // notify relevant observers
 
   if (is_valid) {
     nmea_data->position.set(position);
-    nmea_data->datetime.set(mktime(&time));
+    set_datetime(&time, second);
     nmea_data->speed.set(1852.*speed/3600.);
     nmea_data->true_course.set(2*PI*true_course/360.);
+    set_ground_velocity(1852.*speed/3600., 2*PI*true_course/360.);
     if (variation_defined) {
       nmea_data->variation.set(2*PI*variation/360.);
     }
   }
+  return true;
+}
+
+bool VTGSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+  bool ok = num_terms >= 10;
+  if (!ok) {
+    report_success(ok, sentence());
+    return false;
+  }
+
+  float true_course;
+  bool true_course_defined = false;
+  float magnetic_course;
+  bool magnetic_course_defined = false;
+  float speed;
+  bool speed_defined = false;
+  bool is_valid = true;
+
+  // eg. $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25
+  // 1    054.7      True course (empty if not moving)
+  if (*(buffer+term_offsets[1])!=0) {
+    ok &= parse_float(&true_course, buffer+term_offsets[1]);
+    true_course_defined = true;
+  }
+  // 2    T          True
+  // 3    034.4      Magnetic course
+  if (*(buffer+term_offsets[3])!=0) {
+    ok &= parse_float(&magnetic_course, buffer+term_offsets[3]);
+    magnetic_course_defined = true;
+  }
+  // 4    M          Magnetic
+  // 5    005.5      Speed in knots
+  if (*(buffer+term_offsets[5])!=0) {
+    ok &= parse_float(&speed, buffer+term_offsets[5]);
+    speed_defined = true;
+  }
+  // 6    N          Knots
+  // 7    010.2      Speed in km/h
+  // 8    K          km/h
+  // 9    A          Mode (NMEA 2.3 and later): N = not valid
+  if (num_terms >= 11) {
+    is_valid = *(buffer+term_offsets[9]) != 'N';
+  }
+
+  report_success(ok, sentence());
+  if (!ok) {
+    return false;
+  }
+  // a well-formed sentence without a fix
+  if (!is_valid) {
+    return true;
+  }
+
+  // notify relevant observers
+
+  if (true_course_defined) {
+    nmea_data->true_course.set(2*PI*true_course/360.);
+  }
+  if (magnetic_course_defined) {
+    nmea_data->magnetic_course.set(2*PI*magnetic_course/360.);
+  }
+  if (speed_defined) {
+    nmea_data->speed.set(1852.*speed/3600.);
+  }
+  if (true_course_defined && speed_defined) {
+    set_ground_velocity(1852.*speed/3600., 2*PI*true_course/360.);
+  }
+  return true;
+}
+
+bool GSASentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+  bool ok = num_terms >= 19;
+  if (!ok) {
+    report_success(ok, sentence());
+    return false;
+  }
+
+  int fix_type;
+  float position_dilution;
+  float horizontal_dilution;
+  float vertical_dilution;
+
+  // eg. $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
+  // 1    A          Mode: M = manual, A = automatic 2D/3D
+  // 2    3          Fix type: 1 = none, 2 = 2D, 3 = 3D
+  ok &= parse_int(&fix_type, buffer+term_offsets[2]);
+  // 3-14            IDs of the satellites used for the fix
+  // 15   2.5        PDOP
+  // 16   1.3        HDOP
+  // 17   2.1        VDOP
+  // (18             System ID, NMEA 4.1 and later)
+  report_success(ok, sentence());
+  if (!ok) {
+    return false;
+  }
+
+  nmea_data->fix_type.set(fix_type);
+  if (fix_type < 2) {
+    // the DOP fields are empty or meaningless without a fix
+    return true;
+  }
+  if (parse_float(&position_dilution, buffer+term_offsets[15])) {
+    nmea_data->position_dilution.set(position_dilution);
+  }
+  if (parse_float(&horizontal_dilution, buffer+term_offsets[16])) {
+    nmea_data->horizontal_dilution.set(horizontal_dilution);
+  }
+  if (parse_float(&vertical_dilution, buffer+term_offsets[17])) {
+    nmea_data->vertical_dilution.set(vertical_dilution);
+  }
+  return true;
+}
+
+bool GSVSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+  bool ok = num_terms >= 5;
+  int num_sentences;
+  int sentence_number;
+  int num_in_view;
+
+  // eg. $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
+  // 1    3          Number of sentences in the group
+  // 2    1          Number of this sentence
+  // 3    11         Number of satellites in view
+  // 4-7             ID, elevation, azimuth and SNR of up to four
+  // ...             satellites
+  // (last           Signal ID, NMEA 4.1 and later)
+  if (ok) {
+    ok &= parse_int(&num_sentences, buffer+term_offsets[1]);
+    ok &= parse_int(&sentence_number, buffer+term_offsets[2]);
+    ok &= parse_int(&num_in_view, buffer+term_offsets[3]);
+  }
+
+  report_success(ok, sentence());
+  if (!ok) {
+    next_sentence = 0;
+    return false;
+  }
+
+  if (sentence_number == 1) {
+    pending.talker[0] = buffer[0];
+    pending.talker[1] = buffer[1];
+    pending.talker[2] = 0;
+    pending.num_in_view = num_in_view;
+    pending.count = 0;
+  } else if (sentence_number != next_sentence ||
+             pending.talker[0] != buffer[0] ||
+             pending.talker[1] != buffer[1]) {
+    // missed a part of the group
+    next_sentence = 0;
+    return true;
+  }
+
+  // the satellite blocks end before the checksum term
+  int num_blocks = (num_terms - 5) / 4;
+  for (int i = 0; i < num_blocks; i++) {
+    int term = 4 + 4 * i;
+    SatelliteInfo sat;
+    float elevation;
+    float azimuth;
+    if (!parse_int(&sat.id, buffer+term_offsets[term])) {
+      continue;
+    }
+    sat.elevation = parse_float(&elevation, buffer+term_offsets[term+1])
+                        ? 2*PI*elevation/360. : NAN;
+    sat.azimuth = parse_float(&azimuth, buffer+term_offsets[term+2])
+                      ? 2*PI*azimuth/360. : NAN;
+    if (!parse_float(&sat.snr, buffer+term_offsets[term+3])) {
+      sat.snr = -1;
+    }
+    if (pending.count < MAX_SATELLITES_IN_VIEW) {
+      pending.satellites[pending.count++] = sat;
+    }
+  }
+
+  if (sentence_number == num_sentences) {
+    next_sentence = 0;
+    nmea_data->satellites_in_view.set(pending);
+  } else {
+    next_sentence = sentence_number + 1;
+  }
+  return true;
+}
+
+bool HDTSentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+  bool ok = num_terms >= 4;
+  float heading;
+
+  // eg. $GPHDT,274.07,T*03
+  // 1    274.07     Heading, degrees true
+  // 2    T          True
+  if (ok) {
+    ok &= parse_float(&heading, buffer+term_offsets[1]);
+  }
+
+  report_success(ok, sentence());
+  if (!ok) {
+    return false;
+  }
+
+  nmea_data->heading_true.set(2*PI*heading/360.);
+  return true;
 }
 
-void PSTISentenceParser::parse(
-    char* buffer, int term_offsets[], int num_terms,
-    std::map<String, SentenceParser*>& sentence_parsers
-  ) {
+bool ZDASentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+  bool ok = num_terms >= 8;
+  struct tm time;
+  float second;
+  int year;
+
+  // eg. $GPZDA,201530.00,04,07,2002,00,00*60
+  // 1    201530.00  UTC time
+  // 2    04         Day
+  // 3    07         Month
+  // 4    2002       Year
+  // 5    00         Local zone hours
+  // 6    00         Local zone minutes
+  if (ok) {
+    ok &= parse_time(&time.tm_hour, &time.tm_min, &second, buffer+term_offsets[1]);
+    ok &= parse_int(&time.tm_mday, buffer+term_offsets[2]);
+    ok &= parse_int(&time.tm_mon, buffer+term_offsets[3]);
+    ok &= parse_int(&year, buffer+term_offsets[4]);
+  }
+
+  report_success(ok, sentence());
+  if (!ok) {
+    return false;
+  }
+
+  // date expressed as C struct tm
+  time.tm_year = year - 1900;
+  time.tm_mon -= 1;
+
+  set_datetime(&time, second);
+  return true;
+}
+
+bool PSTISentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
   int subsentence;
 
@@ -362,20 +717,30 @@ void PSTISentenceParser::parse(
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
-  switch (subsentence) {
-    case 30:
-      sentence_parsers["PSTI,030"]->parse(buffer, term_offsets, num_terms);
-      break;
-    case 32:
-      sentence_parsers["PSTI,032"]->parse(buffer, term_offsets, num_terms);
-      break;
+  for (int i = 0; i < num_subsentences; i++) {
+    if (subsentence_ids[i] == subsentence) {
+      return subsentence_parsers[i]->parse(buffer, term_offsets, num_terms);
+    }
+  }
+  return true;
+}
+
+bool PSTISentenceParser::add_subsentence_parser(int id,
+                                                SentenceParser* parser) {
+  if (num_subsentences >= MAX_SUBSENTENCES) {
+    debugE("Too many PSTI sub-sentence parsers");
+    return false;
   }
+  subsentence_ids[num_subsentences] = id;
+  subsentence_parsers[num_subsentences] = parser;
+  num_subsentences++;
+  return true;
 }
 
-void PSTI030SentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+bool PSTI030SentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
 
   struct tm time;
@@ -443,26 +808,25 @@ void PSTI030SentenceParser::parse(char* buffer, int term_offsets[], int num_term
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
-  time.tm_sec = (int)second;
-  time.tm_isdst = 0;
 
   // notify relevant observers
 
-  nmea_data->gnss_quality.set(gnssQualityStrings[quality]);
+  set_gnss_quality(quality);
   nmea_data->rtk_age.set(rtk_age);
   nmea_data->rtk_ratio.set(rtk_ratio);
 
   if (is_valid) {
     nmea_data->position.set(position);
-    nmea_data->datetime.set(mktime(&time));
+    set_datetime(&time, second);
     nmea_data->enu_velocity.set(velocity);
   }
+  return true;
 }
 
-void PSTI032SentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
+bool PSTI032SentenceParser::parse(char* buffer, int term_offsets[], int num_terms) {
   bool ok = true;
 
   struct tm time;
@@ -524,122 +888,447 @@ void PSTI032SentenceParser::parse(char* buffer, int term_offsets[], int num_term
 
   report_success(ok, sentence());
   if (!ok) {
-    return;
+    return false;
   }
 
-  time.tm_sec = (int)second;
-  time.tm_isdst = 0;
 
   if (is_valid) {
-    nmea_data->datetime.set(mktime(&time));
+    set_datetime(&time, second);
     nmea_data->baseline_projection.set(projection);
     nmea_data->baseline_length.set(baseline_length);
     nmea_data->baseline_course.set(2*PI*baseline_course/360.);
-    nmea_data->gnss_quality.set(gnssQualityStrings[quality]);
+    set_gnss_quality(quality);
   }
+  return true;
 }
 
 SentenceParser::SentenceParser(NMEAData* nmea_data) : nmea_data{nmea_data} {}
 
+void SentenceParser::set_gnss_quality(GNSSQuality quality) {
+  // GGA and PSTI report the quality with every fix
+  if (nmea_data->gnss_quality_known &&
+      nmea_data->gnss_quality.get() == quality) {
+    return;
+  }
+  nmea_data->gnss_quality_known = true;
+  nmea_data->gnss_quality.set(quality);
+}
+
+void SentenceParser::set_datetime(struct tm* time, float second) {
+  time->tm_sec = (int)second;
+  time->tm_isdst = 0;
+  time_t t = mktime(time);
+  nmea_data->datetime.set(t);
+  // fixes come at up to 20 Hz; whole seconds would be off by up to 1 s
+  int ms = (int)((second - time->tm_sec) * 1000 + 0.5);
+  nmea_data->datetime_ms.set((int64_t)t * 1000 + ms);
+}
+
+void SentenceParser::set_ground_velocity(float speed, float course) {
+  nmea_data->ground_velocity.set({speed * (float)sin(course),
+                                  speed * (float)cos(course), 0});
+}
+
+// Packs up to five characters of a sentence identifier into an integer,
+// six bits per character. Returns 0 for anything that can't be a
+// valid identifier.
+static uint32_t pack_key(const char* s) {
+  uint32_t key = 0;
+  int i = 0;
+  for (; i < 5 && s[i] != 0 && s[i] != ','; i++) {
+    if (s[i] <= 0x20 || s[i] >= 0x60) {
+      return 0;
+    }
+    key = key << 6 | (s[i] - 0x20);
+  }
+  if (s[i] != 0 && s[i] != ',') {
+    return 0;
+  }
+  return key;
+}
+
+uint32_t pack_sentence_key(const char* s, bool is_address) {
+  if (s[0] == 'P' || !is_address) {
+    return pack_key(s);
+  }
+  if (s[0] == 0 || s[1] == 0) {
+    return 0;
+  }
+  return pack_key(s + 2);
+}
+
 NMEAParser::NMEAParser() {
   term_offsets[0] = 0;
-  current_state = &NMEAParser::state_start;
+  build_sentence_table();
 }
 
 void NMEAParser::add_sentence_parser(SentenceParser* parser) {
   const char* sentence = parser->sentence();
-  sentence_parsers[sentence] = parser;
+  const char* comma = strchr(sentence, ',');
+  if (comma != nullptr) {
+    // a sub-sentence: hand it to the parser of the main sentence
+    uint32_t key = pack_sentence_key(sentence, false);
+    for (auto* main_parser : sentence_parsers) {
+      if (pack_sentence_key(main_parser->sentence(), false) == key) {
+        main_parser->add_subsentence_parser(atoi(comma + 1), parser);
+        return;
+      }
+    }
+    debugE("No parser for the main sentence of %s", sentence);
+    return;
+  }
+  sentence_parsers.push_back(parser);
+  if (!build_sentence_table()) {
+    debugE("Sentence table too small; dropping %s", sentence);
+    sentence_parsers.pop_back();
+    build_sentence_table();
+  }
 }
 
-void NMEAParser::handle(char c) {
-  (this->*(current_state))(c);
+// Finds a multiplier that maps every registered sentence to its own
+// slot, so that a lookup is a single multiplication and comparison.
+bool NMEAParser::build_sentence_table() {
+  hash_multiplier = 2654435761u;
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    memset(sentence_keys, 0, sizeof(sentence_keys));
+    memset(sentence_table, 0, sizeof(sentence_table));
+    memset(active_talkers, 0, sizeof(active_talkers));
+    memset(sentence_counts, 0, sizeof(sentence_counts));
+    bool collision = false;
+    for (auto* parser : sentence_parsers) {
+      uint32_t key = pack_sentence_key(parser->sentence(), false);
+      int slot = sentence_slot(key);
+      if (sentence_table[slot] != nullptr) {
+        collision = true;
+        break;
+      }
+      sentence_keys[slot] = key;
+      sentence_table[slot] = parser;
+    }
+    if (!collision) {
+      return true;
+    }
+    // try the next odd multiplier
+    hash_multiplier += 2 * 0x9e3779b9u;
+  }
+  return false;
 }
 
-void NMEAParser::state_start(char c) {
-  switch (c) {
-    case '$':
-      cur_offset = 0;
-      cur_term = 0;
-      current_state = &NMEAParser::state_in_term;
-      parity = 0;
-      break;
-    default:
-      //anything else can be ignored
-      break;
-  }
+void NMEAParser::start_sentence(char start) {
+  start_char = start;
+  cur_offset = 0;
+  cur_term = 0;
+  parity = 0;
+  state = nmea_in_term;
 }
 
-void NMEAParser::state_in_term(char c) {
-  switch (c) {
-    case ',':
-    case '*':
-      if (cur_offset<INPUT_BUFFER_LENGTH) {
-        // split terms with 0 to help further processing
-        buffer[cur_offset++] = 0;
-      } else {
-        current_state = &NMEAParser::state_start;
+// Characters that end a term. All of them are <= ',', which makes for
+// a cheap first test in the scanning loop.
+static inline bool is_term_delimiter(char c) {
+  return c == ',' || c == '*' || c == '\r' || c == '\n' || c == '$' ||
+         c == '!';
+}
+
+// Sentences start with '$', encapsulation sentences such as AIS
+// messages with '!'
+static inline bool is_sentence_start(char c) { return c == '$' || c == '!'; }
+
+void NMEAParser::handle(const char* data, size_t length) {
+  const char* p = data;
+  const char* end = data + length;
+  counters.chars += length;
+  while (p < end) {
+    switch (state) {
+      case nmea_wait_start: {
+        // anything before the start of a sentence can be ignored
+        while (p < end && !is_sentence_start(*p)) {
+          p++;
+        }
+        if (p == end) {
+          return;
+        }
+        start_sentence(*p++);
         break;
       }
-      if (cur_term<MAX_TERMS) {
-        // advance term offset
-        term_offsets[++cur_term] = cur_offset;
-      } else {
-        current_state = &NMEAParser::state_start;
+      case nmea_in_term: {
+        // copy the term characters and update the checksum in one pass,
+        // leaving room for the terminating 0
+        char* out = buffer + cur_offset;
+        char* out_end = buffer + INPUT_BUFFER_LENGTH - 1;
+        uint8_t sum = parity;
+        while (p < end && out < out_end) {
+          char c = *p;
+          if (c <= ',' && is_term_delimiter(c)) {
+            break;
+          }
+          sum ^= c;
+          *out++ = c;
+          p++;
+        }
+        parity = sum;
+        cur_offset = out - buffer;
+        if (p == end) {
+          return;
+        }
+        if (out == out_end) {
+          // sentence too long
+          counters.overflows++;
+          state = nmea_wait_start;
+          break;
+        }
+        char c = *p++;
+        switch (c) {
+          case ',':
+          case '*':
+            // split terms with 0 to help further processing
+            buffer[cur_offset++] = 0;
+            // the checksum needs room for two characters and the
+            // terminating 0
+            if (cur_term >= MAX_TERMS - 1 ||
+                (c == '*' && cur_offset + 3 > INPUT_BUFFER_LENGTH)) {
+              counters.overflows++;
+              state = nmea_wait_start;
+              break;
+            }
+            term_offsets[++cur_term] = cur_offset;
+            if (c == '*') {
+              state = nmea_in_checksum;
+            } else {
+              parity ^= c;
+            }
+            break;
+          case '$':
+          case '!':
+            // the previous sentence was cut short
+            start_sentence(c);
+            break;
+          default:
+            // end of sentence before checksum has been read
+            counters.checksum_errors++;
+            state = nmea_wait_start;
+            break;
+        }
         break;
       }
-      if (c=='*') {
-        current_state = &NMEAParser::state_in_checksum;
-      } else {
-        parity ^= c;
+      case nmea_in_checksum: {
+        char c = *p++;
+        if (c == '\r' || c == '\n') {
+          buffer[cur_offset] = 0;
+          process_sentence();
+          state = nmea_wait_start;
+        } else if (is_sentence_start(c)) {
+          start_sentence(c);
+        } else if (cur_offset - term_offsets[cur_term] < 2) {
+          buffer[cur_offset++] = c;
+        } else {
+          // there shouldn't be anything else after the checksum
+          counters.checksum_errors++;
+          state = nmea_wait_start;
+        }
+        break;
       }
+    }
+  }
+}
+
+void NMEAParser::forward_sentence() {
+  // the start character, the terms and the checksum, and CR LF. handle()
+  // leaves room for the terminating 0, so cur_offset is below
+  // INPUT_BUFFER_LENGTH.
+  char sentence[1 + INPUT_BUFFER_LENGTH - 1 + 2];
+  if (cur_offset > INPUT_BUFFER_LENGTH - 1) {
+    return;
+  }
+  // restore the separators that were replaced by the term terminators
+  sentence[0] = start_char;
+  memcpy(sentence + 1, buffer, cur_offset);
+  for (int i = 1; i < cur_term; i++) {
+    sentence[term_offsets[i]] = ',';
+  }
+  sentence[term_offsets[cur_term]] = '*';
+  size_t length = cur_offset + 1;
+  sentence[length++] = '\r';
+  sentence[length++] = '\n';
+  forwarder(sentence, length);
+}
+
+void NMEAParser::process_sentence() {
+  if (!validate_checksum()) {
+    counters.checksum_errors++;
+    return;
+  }
+  counters.sentences++;
+  if (forwarder) {
+    forward_sentence();
+  }
+  // call the relevant sentence parser
+  uint32_t key = pack_sentence_key(buffer, true);
+  int slot = sentence_slot(key);
+  if (key == 0 || sentence_keys[slot] != key) {
+    debugD("Parser not found for sentence %s", buffer);
+    counters.unknown_sentences++;
+  } else if (accept_talker(slot, buffer,
+                           sentence_table[slot]->is_per_talker())) {
+    sentence_counts[slot]++;
+    if (!sentence_table[slot]->parse(buffer, term_offsets, cur_term+1)) {
+      counters.parse_failures++;
+    }
+  }
+}
+
+uint32_t NMEAParser::get_sentence_count(const char* sentence) {
+  uint32_t key = pack_sentence_key(sentence, false);
+  int slot = sentence_slot(key);
+  if (key == 0 || sentence_keys[slot] != key) {
+    return 0;
+  }
+  return sentence_counts[slot];
+}
+
+// Emits a new counter value only if it has changed
+static void update_counter(ObservableValue<int>& observable, uint32_t value) {
+  if ((uint32_t)observable.get() != value) {
+    observable.set(value);
+  }
+}
+
+void NMEAParserStats::update(const NMEAParserCounters& counters) {
+  update_counter(chars, counters.chars);
+  update_counter(sentences, counters.sentences);
+  update_counter(checksum_errors, counters.checksum_errors);
+  update_counter(overflows, counters.overflows);
+  update_counter(unknown_sentences, counters.unknown_sentences);
+  update_counter(parse_failures, counters.parse_failures);
+}
+
+void NMEAParserStats::update(NMEAParser& parser) {
+  update(parser.get_counters());
+  if (id_prefix.length() == 0) {
+    return;
+  }
+  for (auto* sentence_parser : parser.get_sentence_parsers()) {
+    String id = id_prefix + "sentences_by_type/" + sentence_parser->sentence();
+    uint32_t count = parser.get_sentence_count(sentence_parser->sentence());
+    auto it = sentences_by_type.find(id);
+    if (it == sentences_by_type.end()) {
+      // the map nodes don't move, so the key can serve as the ID
+      it = sentences_by_type.insert({id, ObservableValue<int>(count)}).first;
+      live_values.add(it->first.c_str(), &it->second);
+    } else {
+      update_counter(it->second, count);
+    }
+  }
+}
+
+void NMEAParserStats::add_live_values(const String& prefix) {
+  id_prefix = prefix;
+  ObservableValue<int>* counters[] = {&chars, &sentences, &checksum_errors,
+                                      &overflows, &unknown_sentences,
+                                      &parse_failures};
+  const char* names[] = {"chars", "sentences", "checksum_errors",
+                         "overflows", "unknown_sentences", "parse_failures"};
+  for (int i = 0; i < 6; i++) {
+    ids[i] = prefix + names[i];
+    live_values.add(ids[i].c_str(), counters[i]);
+  }
+}
+
+void NMEAParser::set_talker_filter(const String& talkers) {
+  num_filtered_talkers = 0;
+  const char* p = talkers.c_str();
+  while (*p != 0 && num_filtered_talkers < MAX_TALKERS) {
+    while (*p == ',' || *p == ' ') {
+      p++;
+    }
+    if (p[0] == 0 || p[1] == 0) {
       break;
-    case '\r':
-    case '\n':
-      // end of sentence before checksum has been read
-      buffer[cur_offset++] = 0;
-      current_state = &NMEAParser::state_start;
-      break;
-    default:
-      // read term characters
-      buffer[cur_offset++] = c;
-      parity ^= c;
-      break;
+    }
+    filtered_talkers[num_filtered_talkers++] = p[0] << 8 | p[1];
+    p += 2;
   }
 }
 
-void NMEAParser::state_in_checksum(char c) {
-  switch (c) {
-    case ',':
-    case '*':
-      // there shouldn't be new terms after the checksum
-      current_state = &NMEAParser::state_start;
-    case '\r':
-    case '\n':
-      // end of sentence
-      buffer[cur_offset++] = 0;
-      if (!validate_checksum()) {
-        current_state = &NMEAParser::state_start;
-        return;
+TalkerStats* NMEAParser::get_talker(const char* address) {
+  char talker[3] = {address[0], 0, 0};
+  if (address[0] != 'P') {
+    talker[1] = address[1];
+  }
+  for (int i = 0; i < num_talkers; i++) {
+    if (talker_stats[i].talker[0] == talker[0] &&
+        talker_stats[i].talker[1] == talker[1]) {
+      return &talker_stats[i];
+    }
+  }
+  if (num_talkers >= MAX_TALKERS) {
+    return nullptr;
+  }
+  TalkerStats* stats = &talker_stats[num_talkers++];
+  memcpy(stats->talker, talker, sizeof(talker));
+  stats->sentences = 0;
+  stats->dropped = 0;
+  return stats;
+}
+
+// Decides whether a sentence from the talker in the given address
+// is passed on to the parser in the given table slot
+bool NMEAParser::accept_talker(int slot, const char* address,
+                               bool per_talker) {
+  TalkerStats* stats = get_talker(address);
+  bool accept = true;
+  if (address[0] != 'P') {
+    uint16_t talker = address[0] << 8 | address[1];
+    bool filtered = num_filtered_talkers > 0;
+    for (int i = 0; i < num_filtered_talkers; i++) {
+      if (filtered_talkers[i] == talker) {
+        filtered = false;
       }
-      // call the relevant sentence parser
-      if (sentence_parsers.find(buffer) == sentence_parsers.end()) {
-        debugD("Parser not found for sentence %s", buffer);
+    }
+    if (filtered) {
+      accept = false;
+    } else if (!per_talker) {
+      uint32_t now = millis();
+      bool is_gn = address[0] == 'G' && address[1] == 'N';
+      bool active_is_gn = active_talkers[slot] == ('G' << 8 | 'N');
+      if (active_talkers[slot] == 0 || active_talkers[slot] == talker ||
+          now - active_talkers_seen[slot] > TALKER_PREFERENCE_TIMEOUT ||
+          (is_gn && !active_is_gn)) {
+        active_talkers[slot] = talker;
+        active_talkers_seen[slot] = now;
       } else {
-        sentence_parsers[buffer]->parse(buffer, term_offsets, cur_term+1,
-                                        sentence_parsers);
+        // the same solution from another talker has been seen already
+        accept = false;
       }
-      current_state = &NMEAParser::state_start;
-      break;
-    default:
-      // read term characters
-      buffer[cur_offset++] = c;
-      break;
+    }
+  }
+  if (stats != nullptr) {
+    if (accept) {
+      stats->sentences++;
+    } else {
+      stats->dropped++;
+    }
+  }
+  return accept;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
   }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
 }
 
 bool NMEAParser::validate_checksum() {
   char* checksum_str = buffer + term_offsets[cur_term];
-  int checksum;
-  sscanf(checksum_str, "%2x", &checksum);
-  return this->parity==checksum;
+  int high = hex_digit(checksum_str[0]);
+  int low = high < 0 ? -1 : hex_digit(checksum_str[1]);
+  if (low < 0) {
+    return false;
+  }
+  return this->parity == (high << 4 | low);
 }
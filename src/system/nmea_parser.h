@@ -3,12 +3,26 @@
 
 #include "Arduino.h"
 
+#include <functional>
 #include <map>
+#include <vector>
 
 #include "observablevalue.h"
 
 constexpr int INPUT_BUFFER_LENGTH = 250;
 constexpr int MAX_TERMS = 25;
+// Size of the sentence dispatch table, as a power of two. Must leave
+// room for a perfect hash of all registered sentences.
+constexpr int SENTENCE_TABLE_BITS = 5;
+// Maximum number of sub-sentences of a proprietary sentence
+constexpr int MAX_SUBSENTENCES = 4;
+// Maximum number of talkers statistics are kept for
+constexpr int MAX_TALKERS = 8;
+// Time (ms) a sentence from the combined GN talker blocks the same
+// sentence from the single-constellation talkers
+constexpr uint32_t TALKER_PREFERENCE_TIMEOUT = 2500;
+// Maximum number of satellites reported per constellation
+constexpr int MAX_SATELLITES_IN_VIEW = 20;
 
 struct Position {
   double latitude;
@@ -22,90 +36,227 @@ struct ENUVector {
   float up;
 };
 
+// Quality of the GNSS fix. The values up to simulator_mode match the
+// quality indicator of GGA.
+enum class GNSSQuality {
+  no_gps,
+  gnss_fix,
+  dgnss_fix,
+  precise_gnss,
+  rtk_fixed_integer,
+  rtk_float,
+  estimated_mode,
+  manual_input,
+  simulator_mode,
+  error
+};
+
+/**
+ * Returns the human readable name of a GNSSQuality, stored in flash.
+ * Values out of range are reported as "Error".
+ */
+const __FlashStringHelper* gnss_quality_name(GNSSQuality quality);
+
+// Parsers of the terms of a sentence. Each returns false if the term
+// is malformed, and leaves the value unchanged then.
+bool parse_int(int* value, char* s);
+bool parse_double(double* value, char* s);
+bool parse_float(float* value, char* s);
+/// Parses an unsigned latitude or longitude in the format (d)ddmm.mmmm
+bool parse_latlon(double* value, char* s);
+/// Negates the value for the southern hemisphere
+bool parse_NS(double* value, char* s);
+/// Negates the value for the western hemisphere
+bool parse_EW(double* value, char* s);
+/// Parses a time hhmmss.ss
+bool parse_time(int* hour, int* minute, float* second, char* s);
+/// Parses a date ddmmyy into the fields of a struct tm
+bool parse_date(int* year, int* month, int* day, char* s);
+
+struct SatelliteInfo {
+  int id;
+  // elevation and azimuth in radians, NAN if unknown
+  float elevation;
+  float azimuth;
+  // signal to noise ratio in dB-Hz, -1 if the satellite isn't tracked
+  float snr;
+};
+
+// The satellites of one constellation, assembled from a GSV group
+struct SatellitesInView {
+  // talker of the constellation, e.g. "GP" or "GL"
+  char talker[3];
+  // number of satellites in view as reported by the receiver
+  int num_in_view;
+  // number of valid entries in satellites
+  int count;
+  SatelliteInfo satellites[MAX_SATELLITES_IN_VIEW];
+};
+
 struct NMEAData {
   ObservableValue<Position> position;
-  ObservableValue<String> gnss_quality;
+  // only notified when the quality changes
+  ObservableValue<GNSSQuality> gnss_quality;
+  bool gnss_quality_known = false;
   ObservableValue<int> num_satellites;
   ObservableValue<float> horizontal_dilution;
   ObservableValue<float> geoidal_separation;
   ObservableValue<float> dgps_age;
   ObservableValue<float> dgps_id;
   ObservableValue<time_t> datetime;
+  // the time of the fix in milliseconds since the epoch, including the
+  // fractional seconds that datetime drops
+  ObservableValue<int64_t> datetime_ms;
   ObservableValue<float> speed;
   ObservableValue<float> true_course;
   ObservableValue<float> variation;
   ObservableValue<ENUVector> enu_velocity;
+  // the speed and true course over ground of one sentence as an
+  // east/north velocity (m/s); up is 0
+  ObservableValue<ENUVector> ground_velocity;
   ObservableValue<float> rtk_age;
   ObservableValue<float> rtk_ratio;
   ObservableValue<ENUVector> baseline_projection;
   ObservableValue<float> baseline_length;
   ObservableValue<float> baseline_course;
+  ObservableValue<float> magnetic_course;
+  ObservableValue<float> heading_true;
+  // 1 = no fix, 2 = 2D fix, 3 = 3D fix
+  ObservableValue<int> fix_type;
+  ObservableValue<float> position_dilution;
+  ObservableValue<float> vertical_dilution;
+  ObservableValue<SatellitesInView> satellites_in_view;
 };
 
 class SentenceParser {
  public:
   SentenceParser(NMEAData* nmea_data);
-  virtual void parse(char* buffer, int term_offsets[], int num_terms) = 0;
-  virtual void parse(
-    char* buffer, int term_offsets[], int num_terms,
-    std::map<String, SentenceParser*>& sentence_parsers
-  ) {
-    parse(buffer, term_offsets, num_terms);
-  }
+  /**
+   * Parses the terms of a sentence with a valid checksum.
+   * @return false if the sentence is malformed
+   */
+  virtual bool parse(char* buffer, int term_offsets[], int num_terms) = 0;
+  /**
+   * Returns the sentence handled by the parser. Standard sentences are
+   * identified by their formatter, e.g. "GGA", and match any talker.
+   * Proprietary sentences use their full address, e.g. "PSTI". Parsers
+   * of proprietary sub-sentences append the sub-sentence number, e.g.
+   * "PSTI,030", and are registered with the parser of the main sentence.
+   */
   virtual const char* sentence() = 0;
+  /**
+   * Registers a parser for a sub-sentence of this sentence.
+   * @return false if this sentence has no sub-sentences
+   */
+  virtual bool add_subsentence_parser(int id, SentenceParser* parser) {
+    return false;
+  }
+  /**
+   * Returns true if each talker reports its own data in this sentence,
+   * e.g. the satellites of its constellation. Such sentences are never
+   * dropped in favor of another talker.
+   */
+  virtual bool is_per_talker() { return false; }
  protected:
   NMEAData* nmea_data;
+  /// Sets the GNSS quality, notifying the observers only if it changed
+  void set_gnss_quality(GNSSQuality quality);
+  /// Sets the time of a fix; time holds everything but the seconds
+  void set_datetime(struct tm* time, float second);
+  /// Sets the ground velocity from a speed (m/s) and course (rad)
+  void set_ground_velocity(float speed, float course);
+ private:
+};
+
+class GGASentenceParser : public SentenceParser {
+ public:
+  GGASentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "GGA"; }
+ private:
+};
+
+class GLLSentenceParser : public SentenceParser {
+ public:
+  GLLSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "GLL"; }
  private:
 };
 
-class GPGGASentenceParser : public SentenceParser {
+class RMCSentenceParser : public SentenceParser {
  public:
-  GPGGASentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final;
-  const char* sentence() { return "GPGGA"; }
+  RMCSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "RMC"; }
  private:
 };
 
-class GPGLLSentenceParser : public SentenceParser {
+class VTGSentenceParser : public SentenceParser {
  public:
-  GPGLLSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final;
-  const char* sentence() { return "GPGLL"; }
+  VTGSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "VTG"; }
  private:
 };
 
-class GPRMCSentenceParser : public SentenceParser {
+class GSASentenceParser : public SentenceParser {
  public:
-  GPRMCSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final;
-  const char* sentence() { return "GPRMC"; }
+  GSASentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "GSA"; }
+  bool is_per_talker() override { return true; }
  private:
 };
 
-//class GPVTGSentenceParser : public SentenceParser {
-// public:
-//  GPVTGSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-//  void parse(char* buffer, int term_offsets[], int num_terms) override final;
-//  const char* sentence() { return "GPVTG"; }
-// private:
-//};
+/**
+ * Assembles the sentences of a GSV group and notifies
+ * NMEAData::satellites_in_view once the group is complete.
+ */
+class GSVSentenceParser : public SentenceParser {
+ public:
+  GSVSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "GSV"; }
+  bool is_per_talker() override { return true; }
+ private:
+  SatellitesInView pending;
+  // number of the next sentence expected in the group, 0 if none
+  int next_sentence = 0;
+};
+
+class HDTSentenceParser : public SentenceParser {
+ public:
+  HDTSentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "HDT"; }
+ private:
+};
+
+class ZDASentenceParser : public SentenceParser {
+ public:
+  ZDASentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
+  const char* sentence() { return "ZDA"; }
+ private:
+};
 
 class PSTISentenceParser : public SentenceParser {
  public:
   PSTISentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final {}
-  void parse(
-    char* buffer, int term_offsets[], int num_terms,
-    std::map<String, SentenceParser*>& sentence_parsers
-  );
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
   const char* sentence() { return "PSTI"; }
+  bool add_subsentence_parser(int id, SentenceParser* parser) override;
  private:
+  int num_subsentences = 0;
+  int subsentence_ids[MAX_SUBSENTENCES];
+  SentenceParser* subsentence_parsers[MAX_SUBSENTENCES];
 };
 
 class PSTI030SentenceParser : public SentenceParser {
  public:
   PSTI030SentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final;
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
   const char* sentence() { return "PSTI,030"; }
  private:
 };
@@ -113,21 +264,103 @@ class PSTI030SentenceParser : public SentenceParser {
 class PSTI032SentenceParser : public SentenceParser {
  public:
   PSTI032SentenceParser(NMEAData* nmea_data) : SentenceParser{nmea_data} {}
-  void parse(char* buffer, int term_offsets[], int num_terms) override final;
+  bool parse(char* buffer, int term_offsets[], int num_terms) override final;
   const char* sentence() { return "PSTI,032"; }
  private:
 };
 
+enum NMEAParserState {
+  // skipping characters until the next '$' or '!'
+  nmea_wait_start,
+  // reading the terms of a sentence
+  nmea_in_term,
+  // reading the checksum after the '*'
+  nmea_in_checksum
+};
+
+/// Number of sentences received from one talker, e.g. "GP" or "GN"
+struct TalkerStats {
+  // the talker, or "P" for proprietary sentences
+  char talker[3];
+  // sentences passed on to a parser
+  uint32_t sentences;
+  // sentences dropped by the talker filter or in favor of the GN talker
+  uint32_t dropped;
+};
+
+/// Counters of an NMEAParser since boot
+struct NMEAParserCounters {
+  uint32_t chars;
+  // sentences with a valid checksum
+  uint32_t sentences;
+  // sentences with a wrong or missing checksum
+  uint32_t checksum_errors;
+  // sentences longer than INPUT_BUFFER_LENGTH or with more than MAX_TERMS
+  uint32_t overflows;
+  // sentences without a registered parser
+  uint32_t unknown_sentences;
+  // sentences the parser rejected as malformed
+  uint32_t parse_failures;
+};
+
+/**
+ * NMEAParser splits NMEA 0183 sentences into terms, validates their
+ * checksum and passes them on to the registered SentenceParsers.
+ *
+ * Standard sentences are matched regardless of their talker, so that
+ * e.g. $GPGGA and $GNGGA both reach the GGA parser. If a receiver
+ * reports the same sentence for several talkers, the combined GN
+ * solution is preferred; otherwise the first talker seen is kept until
+ * it stops sending.
+ */
 class NMEAParser {
 public:
   NMEAParser();
-  void handle(char c);
+  void handle(char c) { handle(&c, 1); }
+  /**
+   * Processes a block of received characters. The terms are scanned
+   * and checksummed span by span, which is considerably faster than
+   * feeding the characters one at a time.
+   */
+  void handle(const char* data, size_t length);
   void add_sentence_parser(SentenceParser* parser);
+  /**
+   * Only accepts standard sentences from the given talkers.
+   * @param talkers Comma separated talker IDs, e.g. "GN,GP".
+   *   An empty string accepts all talkers.
+   */
+  void set_talker_filter(const String& talkers);
+  const TalkerStats* get_talker_stats() { return talker_stats; }
+  int get_num_talkers() { return num_talkers; }
+  /**
+   * Sets a function that receives every sentence with a valid checksum
+   * before it is parsed, as it was received and including the trailing
+   * CR LF, e.g. for forwarding it to another port.
+   */
+  void set_sentence_forwarder(
+      std::function<void(const char*, size_t)> forwarder) {
+    this->forwarder = forwarder;
+  }
+  const NMEAParserCounters& get_counters() { return counters; }
+  /**
+   * Returns the number of sentences passed on to the parser of the given
+   * sentence, e.g. "GGA"
+   */
+  uint32_t get_sentence_count(const char* sentence);
+  const std::vector<SentenceParser*>& get_sentence_parsers() {
+    return sentence_parsers;
+  }
 private:
-  void (NMEAParser::* current_state) (char);
-  void state_start(char c);
-  void state_in_term(char c);
-  void state_in_checksum(char c);
+  NMEAParserCounters counters = {};
+  // sentences passed on to each parser of the sentence table
+  uint32_t sentence_counts[1 << SENTENCE_TABLE_BITS];
+  NMEAParserState state = nmea_wait_start;
+  void start_sentence(char start);
+  void process_sentence();
+  void forward_sentence();
+  std::function<void(const char*, size_t)> forwarder;
+  // '$' or '!'
+  char start_char;
   // current sentence
   char buffer[INPUT_BUFFER_LENGTH];
   // offset for each sentence term in the buffer
@@ -136,9 +369,72 @@ private:
   int cur_offset;
   // pointer for the current term in buffer
   int cur_term;
-  int parity;
+  uint8_t parity;
   bool validate_checksum();
-  std::map<String, SentenceParser*> sentence_parsers;
+  // all registered parsers of top-level sentences
+  std::vector<SentenceParser*> sentence_parsers;
+  // perfect hash table of the parsers, keyed by the packed sentence
+  // address; rebuilt whenever a parser is added
+  uint32_t sentence_keys[1 << SENTENCE_TABLE_BITS];
+  SentenceParser* sentence_table[1 << SENTENCE_TABLE_BITS];
+  // talker currently preferred for each sentence, and when it was seen
+  uint16_t active_talkers[1 << SENTENCE_TABLE_BITS];
+  uint32_t active_talkers_seen[1 << SENTENCE_TABLE_BITS];
+  // packed talker IDs accepted by the filter; none means all
+  uint16_t filtered_talkers[MAX_TALKERS];
+  int num_filtered_talkers = 0;
+  TalkerStats talker_stats[MAX_TALKERS];
+  int num_talkers = 0;
+  TalkerStats* get_talker(const char* address);
+  bool accept_talker(int slot, const char* address, bool per_talker);
+  uint32_t hash_multiplier;
+  int sentence_slot(uint32_t key) {
+    return (key * hash_multiplier) >> (32 - SENTENCE_TABLE_BITS);
+  }
+  bool build_sentence_table();
+};
+
+/**
+ * Packs up to five characters of a sentence address or formatter into
+ * an integer key. For received addresses (is_address) of standard
+ * sentences, the talker is skipped, so that "GPRMC" and "RMC" have the
+ * same key. Returns 0 if the string doesn't fit.
+ */
+uint32_t pack_sentence_key(const char* s, bool is_address);
+
+// Interval (ms) at which NMEAParserStats are updated
+#ifndef NMEA_STATS_INTERVAL
+#define NMEA_STATS_INTERVAL 5000
+#endif
+
+/**
+ * The counters of an NMEAParser as producers, e.g. for connecting them
+ * to SKOutputInt. Call update() periodically; the values are only
+ * emitted when they have changed.
+ */
+class NMEAParserStats {
+ public:
+  ObservableValue<int> chars{0};
+  ObservableValue<int> sentences{0};
+  ObservableValue<int> checksum_errors{0};
+  ObservableValue<int> overflows{0};
+  ObservableValue<int> unknown_sentences{0};
+  ObservableValue<int> parse_failures{0};
+
+  void update(const NMEAParserCounters& counters);
+  /// Updates the counters and the number of sentences of each type
+  void update(NMEAParser& parser);
+  /**
+   * Makes the counters live values, e.g. "<prefix>sentences" and
+   * "<prefix>sentences_by_type/GGA"
+   */
+  void add_live_values(const String& prefix);
+
+ private:
+  String id_prefix;
+  String ids[6];
+  // the number of sentences of each type, by live value ID
+  std::map<String, ObservableValue<int>> sentences_by_type;
 };
 
 
@@ -0,0 +1,297 @@
+#include "sensesp.h"
+
+#include "storage.h"
+
+#include "system/config_store.h"
+
+#ifdef ESP32
+#include "SPIFFS.h"
+#endif
+#if SENSESP_STORAGE_LITTLEFS
+#include "LittleFS.h"
+#endif
+
+Storage* storage = nullptr;
+
+bool FSStorage::exists(const String& path) { return fs.exists(path); }
+
+std::unique_ptr<Stream> FSStorage::open(const String& path,
+                                        const char* mode) {
+#ifdef ESP32
+  // unlike on ESP8266, the directories of a path aren't created
+  if (mode[0] == 'w') {
+    for (int i = path.indexOf('/', 1); i > 0; i = path.indexOf('/', i + 1)) {
+      String dir = path.substring(0, i);
+      if (!fs.exists(dir)) {
+        fs.mkdir(dir);
+      }
+    }
+  }
+#endif
+  File f = fs.open(path, mode);
+  if (!f) {
+    return nullptr;
+  }
+  return std::unique_ptr<Stream>(new File(f));
+}
+
+bool FSStorage::remove(const String& path) { return fs.remove(path); }
+
+bool FSStorage::rename(const String& from, const String& to) {
+  // SPIFFS doesn't replace an existing file
+  if (fs.exists(to)) {
+    fs.remove(to);
+  }
+  return fs.rename(from, to);
+}
+
+void FSStorage::list(std::function<void(const String&)> cb) {
+  list_dir("/", cb);
+}
+
+void FSStorage::list_dir(const String& dir,
+                         std::function<void(const String&)> cb) {
+  // SPIFFS has no directories and reports the full path of each file;
+  // LittleFS reports the names within the directory
+#ifdef ESP8266
+  Dir d = fs.openDir(dir);
+  while (d.next()) {
+    String name = d.fileName();
+    String path = name.startsWith("/") ? name : dir + name;
+    if (d.isDirectory()) {
+      list_dir(path + "/", cb);
+    } else {
+      cb(path);
+    }
+  }
+#elif defined(ESP32)
+  File root = fs.open(dir);
+  if (!root) {
+    return;
+  }
+  for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+    String name = f.name();
+    String path = name.startsWith("/") ? name : dir + name;
+    bool is_directory = f.isDirectory();
+    f.close();
+    if (is_directory) {
+      list_dir(path + "/", cb);
+    } else {
+      cb(path);
+    }
+  }
+#endif
+}
+
+SPIFFSStorage::SPIFFSStorage(bool format_on_fail)
+    : FSStorage(SPIFFS), format_on_fail{format_on_fail} {}
+
+bool SPIFFSStorage::begin() {
+#ifdef ESP8266
+  SPIFFSConfig config;
+  config.setAutoFormat(format_on_fail);
+  SPIFFS.setConfig(config);
+  return SPIFFS.begin();
+#elif defined(ESP32)
+  return SPIFFS.begin(format_on_fail);
+#endif
+}
+
+bool SPIFFSStorage::format() { return SPIFFS.format(); }
+
+void SPIFFSStorage::end() { SPIFFS.end(); }
+
+#if SENSESP_STORAGE_LITTLEFS
+LittleFSStorage::LittleFSStorage() : FSStorage(LittleFS) {}
+
+bool LittleFSStorage::begin() {
+#ifdef ESP8266
+  // don't format a partition that still holds SPIFFS
+  LittleFSConfig config;
+  config.setAutoFormat(false);
+  LittleFS.setConfig(config);
+  return LittleFS.begin();
+#elif defined(ESP32)
+  return LittleFS.begin(false);
+#endif
+}
+
+bool LittleFSStorage::format() { return LittleFS.format(); }
+#endif
+
+/// A file of a RAMStorage
+class RAMFile : public Stream {
+ public:
+  RAMFile(String& data) : data(data) {}
+  int available() override { return data.length() - position; }
+  int read() override {
+    return position < data.length() ? (uint8_t)data[position++] : -1;
+  }
+  int peek() override {
+    return position < data.length() ? (uint8_t)data[position] : -1;
+  }
+  size_t write(uint8_t c) override { return data.concat((char)c) ? 1 : 0; }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    // a short write tells that the heap is exhausted
+    if (!data.reserve(data.length() + size)) {
+      return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+      data += (char)buffer[i];
+    }
+    return size;
+  }
+  using Print::write;
+  void flush() override {}
+
+ private:
+  String& data;
+  size_t position = 0;
+};
+
+bool RAMStorage::format() {
+  files.clear();
+  return true;
+}
+
+bool RAMStorage::exists(const String& path) {
+  return files.find(path) != files.end();
+}
+
+std::unique_ptr<Stream> RAMStorage::open(const String& path,
+                                         const char* mode) {
+  if (mode[0] == 'w') {
+    files[path] = "";
+  } else if (!exists(path)) {
+    return nullptr;
+  }
+  return std::unique_ptr<Stream>(new RAMFile(files[path]));
+}
+
+bool RAMStorage::remove(const String& path) { return files.erase(path) > 0; }
+
+bool RAMStorage::rename(const String& from, const String& to) {
+  auto it = files.find(from);
+  if (it == files.end()) {
+    return false;
+  }
+  String data = it->second;
+  files.erase(it);
+  files[to] = data;
+  return true;
+}
+
+void RAMStorage::list(std::function<void(const String&)> cb) {
+  for (auto& file : files) {
+    cb(file.first);
+  }
+}
+
+bool copy_files(Storage* from, Storage* to) {
+  bool copied = true;
+  from->list([from, to, &copied](const String& path) {
+    auto in = from->open(path, "r");
+    auto out = to->open(path, "w");
+    bool ok = in && out;
+    if (ok) {
+      uint8_t buf[128];
+      size_t len;
+      while (ok && (len = in->readBytes(buf, sizeof(buf))) > 0) {
+        ok = out->write(buf, len) == len;
+      }
+      ok = ok && in->available() == 0;
+    }
+    if (!ok) {
+      debugE("Could not copy %s", path.c_str());
+      copied = false;
+    }
+  });
+  return copied;
+}
+
+/// @return The total size of all files
+static size_t total_size(Storage* storage) {
+  size_t total = 0;
+  storage->list([storage, &total](const String& path) {
+    auto f = storage->open(path, "r");
+    if (f) {
+      total += f->available();
+    }
+  });
+  return total;
+}
+
+void setup_storage() {
+#if SENSESP_STORAGE_LITTLEFS
+  static LittleFSStorage littlefs;
+  if (!littlefs.begin()) {
+    // The partition holds SPIFFS or nothing. Keep its files in RAM while
+    // it is formatted for LittleFS.
+    static SPIFFSStorage spiffs(false);
+    std::unique_ptr<RAMStorage> ram(new RAMStorage());
+    if (spiffs.begin()) {
+      size_t size = total_size(&spiffs);
+      if (size + SETUP_STORAGE_HEAP_RESERVE > ESP.getFreeHeap()) {
+        debugE("The files on SPIFFS don't fit in RAM; keeping SPIFFS");
+        storage = &spiffs;
+        return;
+      }
+      if (!copy_files(&spiffs, ram.get())) {
+        // formatting would lose the files that aren't in RAM
+        debugE("Could not move the files from SPIFFS; keeping SPIFFS");
+        storage = &spiffs;
+        return;
+      }
+      spiffs.end();
+      debugI("Moving the files from SPIFFS to LittleFS");
+    }
+    if (!littlefs.format() || !littlefs.begin()) {
+      debugE("FATAL: Filesystem initialization failed.");
+      ESP.restart();
+    }
+    if (!copy_files(ram.get(), &littlefs)) {
+      // the configuration is still imported from the copy in RAM
+      debugE("Could not move all files to LittleFS");
+      config_store.import_legacy_from(ram.release());
+    }
+  }
+  storage = &littlefs;
+#else
+  static SPIFFSStorage spiffs;
+  if (!spiffs.begin()) {
+    debugE("FATAL: Filesystem initialization failed.");
+    ESP.restart();
+  }
+  storage = &spiffs;
+#endif
+}
+
+void write_string(const String filename, String data) {
+  auto f = storage->open(filename, "w");
+  if (f) {
+    f->print(data);
+  }
+}
+
+String read_string(const String filename) {
+  auto f = storage->open(filename, "r");
+  if (!f) {
+    return "";
+  }
+  return f->readString();
+}
+
+void write_json(const String filename, JsonObject& data) {
+  auto f = storage->open(filename, "w");
+  if (f) {
+    data.printTo(*f);
+  }
+}
+
+JsonObject& read_json(const String filename, JsonBuffer& buf) {
+  auto f = storage->open(filename, "r");
+  if (!f) {
+    return JsonObject::invalid();
+  }
+  return buf.parseObject(*f);
+}
@@ -0,0 +1,136 @@
+#ifndef _storage_H_
+#define _storage_H_
+
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "Arduino.h"
+#include "ArduinoJson.h"
+#include "FS.h"
+
+// Use LittleFS instead of SPIFFS. The ESP32 core only includes LittleFS
+// from version 2.0 on.
+#ifndef SENSESP_STORAGE_LITTLEFS
+#ifdef ESP8266
+#define SENSESP_STORAGE_LITTLEFS 1
+#else
+#define SENSESP_STORAGE_LITTLEFS 0
+#endif
+#endif
+
+// Free heap (bytes) to keep beyond the size of the files when moving
+// them from SPIFFS to LittleFS through RAM
+#ifndef SETUP_STORAGE_HEAP_RESERVE
+#define SETUP_STORAGE_HEAP_RESERVE 8192
+#endif
+
+/**
+ * Storage is the file system on which SensESP persists its data, e.g.
+ * the configuration. Files are accessed as Streams, so that the same
+ * code works on the flash file systems of the device and on the
+ * RAMStorage used for tests and benchmarks on the host.
+ */
+class Storage {
+ public:
+  virtual ~Storage() {}
+  virtual bool begin() = 0;
+  /// Erases all files
+  virtual bool format() = 0;
+  virtual bool exists(const String& path) = 0;
+  /**
+   * Opens a file for reading ("r") or for writing ("w"), replacing its
+   * previous content. The file is closed when the Stream is deleted.
+   * @return nullptr if the file can't be opened
+   */
+  virtual std::unique_ptr<Stream> open(const String& path,
+                                       const char* mode) = 0;
+  virtual bool remove(const String& path) = 0;
+  /// Renames a file, replacing any file at the new path
+  virtual bool rename(const String& from, const String& to) = 0;
+  /// Calls cb with the full path of every file, including subdirectories
+  virtual void list(std::function<void(const String&)> cb) = 0;
+};
+
+/// Common base of the storages on the file systems of the ESP cores
+class FSStorage : public Storage {
+ public:
+  FSStorage(fs::FS& fs) : fs(fs) {}
+  bool exists(const String& path) override;
+  std::unique_ptr<Stream> open(const String& path, const char* mode) override;
+  bool remove(const String& path) override;
+  bool rename(const String& from, const String& to) override;
+  void list(std::function<void(const String&)> cb) override;
+
+ protected:
+  fs::FS& fs;
+
+ private:
+  void list_dir(const String& dir, std::function<void(const String&)> cb);
+};
+
+class SPIFFSStorage : public FSStorage {
+ public:
+  /// @param format_on_fail Format the partition if it holds no SPIFFS
+  SPIFFSStorage(bool format_on_fail = true);
+  bool begin() override;
+  bool format() override;
+  void end();
+
+ private:
+  bool format_on_fail;
+};
+
+#if SENSESP_STORAGE_LITTLEFS
+/**
+ * LittleFS is faster than SPIFFS at opening files and checking whether
+ * they exist, and survives power loss during writes.
+ */
+class LittleFSStorage : public FSStorage {
+ public:
+  LittleFSStorage();
+  bool begin() override;
+  bool format() override;
+};
+#endif
+
+/// Keeps the files in RAM; nothing survives a restart
+class RAMStorage : public Storage {
+ public:
+  bool begin() override { return true; }
+  bool format() override;
+  bool exists(const String& path) override;
+  std::unique_ptr<Stream> open(const String& path, const char* mode) override;
+  bool remove(const String& path) override;
+  bool rename(const String& from, const String& to) override;
+  void list(std::function<void(const String&)> cb) override;
+
+ private:
+  std::map<String, String> files;
+};
+
+/**
+ * Copies all files from one storage to another
+ * @return false if any file couldn't be copied completely
+ */
+bool copy_files(Storage* from, Storage* to);
+
+/// The storage used by SensESP, set by setup_storage()
+extern Storage* storage;
+
+/**
+ * Mounts the file system of the device and makes it the storage.
+ * With LittleFS, the files of a SPIFFS file system left by an earlier
+ * version are moved over on the first boot. SPIFFS is kept if its
+ * files can't all be read first.
+ */
+void setup_storage();
+
+void write_string(const String filename, String data);
+String read_string(const String filename);
+
+void write_json(const String filename, JsonObject& data);
+/// @return An object whose success() is false if the file can't be read
+JsonObject& read_json(const String filename, JsonBuffer& buf);
+
+#endif
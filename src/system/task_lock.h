@@ -0,0 +1,41 @@
+#ifndef _task_lock_H_
+#define _task_lock_H_
+
+#ifdef ESP32
+#include <mutex>
+#endif
+
+/**
+ * TaskMutex guards data that the main loop shares with the callbacks of
+ * the network stack. On ESP32, AsyncTCP runs those callbacks in a task
+ * of its own. On ESP8266, network callbacks never preempt the main
+ * loop, so there is nothing to guard and the mutex does nothing.
+ *
+ * Keep the guarded sections short, and don't call into other code while
+ * holding the lock.
+ */
+class TaskMutex {
+ public:
+#ifdef ESP32
+  void lock() { mutex.lock(); }
+  void unlock() { mutex.unlock(); }
+
+ private:
+  std::mutex mutex;
+#else
+  void lock() {}
+  void unlock() {}
+#endif
+};
+
+/// Holds a TaskMutex for as long as it exists
+class TaskLock {
+ public:
+  TaskLock(TaskMutex& mutex) : mutex(mutex) { mutex.lock(); }
+  ~TaskLock() { mutex.unlock(); }
+
+ private:
+  TaskMutex& mutex;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "time_sync.h"
+
+#include <sys/time.h>
+
+#include "sensesp.h"
+
+// Interval (ms) at which the SNTP-disciplined system clock is sampled
+#ifndef TIME_SYNC_SNTP_POLL
+#define TIME_SYNC_SNTP_POLL 60000
+#endif
+
+// The system clock is considered set by SNTP once it's past 2020-01-01
+#define SNTP_VALID_AFTER 1577836800
+
+TimeSync::TimeSync(String config_path) : Configurable{config_path} {
+  load_configuration();
+}
+
+void TimeSync::enable() {
+  if (sntp_server.length() > 0) {
+    debugI("Starting SNTP with server %s", sntp_server.c_str());
+    configTime(0, 0, sntp_server.c_str());
+    app.onRepeat(TIME_SYNC_SNTP_POLL, [this]() { this->poll_sntp(); });
+  }
+  // millis() wraps after 49 days; make sure every wrap is noticed
+  app.onRepeat(60 * 60 * 1000, [this]() { this->monotonic_ms(); });
+}
+
+uint64_t TimeSync::monotonic_ms() {
+  uint32_t now = millis();
+  if (now < last_millis) {
+    millis_wraps++;
+  }
+  last_millis = now;
+  return ((uint64_t)millis_wraps << 32) | now;
+}
+
+int64_t TimeSync::to_utc(uint64_t monotonic_ms) {
+  int64_t elapsed = (int64_t)(monotonic_ms - base_monotonic);
+  return base_utc + elapsed + (int64_t)(elapsed * drift_ppm / 1e6);
+}
+
+void TimeSync::step(TimeSource source, int64_t utc_ms, uint64_t monotonic_ms) {
+  if (source != this->source) {
+    debugI("Time source changed from %d to %d", this->source, source);
+  }
+  this->source = source;
+  base_monotonic = monotonic_ms;
+  base_utc = utc_ms;
+  correction_sum = 0;
+  drift_interval_start = monotonic_ms;
+}
+
+void TimeSync::add_sample(TimeSource source, int64_t utc_ms,
+                          uint64_t monotonic_ms) {
+  bool current_stale =
+      monotonic_ms - last_sample > TIME_SYNC_SOURCE_TIMEOUT;
+  if (source < this->source && !current_stale) {
+    // a more accurate source is active
+    return;
+  }
+  last_sample = monotonic_ms;
+
+  int64_t error = utc_ms - to_utc(monotonic_ms);
+  if (source != this->source || error > TIME_SYNC_STEP_THRESHOLD ||
+      error < -TIME_SYNC_STEP_THRESHOLD) {
+    this->step(source, utc_ms, monotonic_ms);
+    return;
+  }
+
+  // move a quarter of the way towards the sample to average out jitter
+  int64_t correction = error / 4;
+  base_utc = to_utc(monotonic_ms) + correction;
+  base_monotonic = monotonic_ms;
+  correction_sum += correction;
+
+  // corrections that keep adding up in one direction are drift
+  uint64_t interval = monotonic_ms - drift_interval_start;
+  if (interval >= TIME_SYNC_DRIFT_INTERVAL) {
+    drift_ppm += correction_sum * 1e6 / interval / 2;
+    drift_ppm = max(-(float)TIME_SYNC_MAX_DRIFT,
+                    min(drift_ppm, (float)TIME_SYNC_MAX_DRIFT));
+    correction_sum = 0;
+    drift_interval_start = monotonic_ms;
+  }
+}
+
+void TimeSync::set_input(int64_t input, uint8_t input_channel) {
+  if (input == last_gnss_time) {
+    return;
+  }
+  last_gnss_time = input;
+  add_sample(time_source_gnss, input);
+}
+
+void TimeSync::poll_sntp() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < SNTP_VALID_AFTER) {
+    return;
+  }
+  add_sample(time_source_sntp,
+             (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000);
+}
+
+JsonObject& TimeSync::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["sntp_server"] = sntp_server;
+  return root;
+}
+
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "sntp_server": { "title": "SNTP server", "type": "string", "description": "Leave empty to disable SNTP. Takes effect after a restart" }
+    }
+  })";
+
+PGM_P TimeSync::get_config_schema_P() { return SCHEMA; }
+
+bool TimeSync::set_configuration(const JsonObject& config) {
+  if (!config.containsKey("sntp_server")) {
+    return false;
+  }
+  sntp_server = config["sntp_server"].as<String>();
+  return true;
+}
@@ -0,0 +1,121 @@
+#ifndef _time_sync_H_
+#define _time_sync_H_
+
+#include <ctime>
+
+#include "Arduino.h"
+
+#include "system/configurable.h"
+#include "system/valueconsumer.h"
+
+// Errors (ms) larger than this make the clock jump to the new time
+// instead of slowly converging to it
+#ifndef TIME_SYNC_STEP_THRESHOLD
+#define TIME_SYNC_STEP_THRESHOLD 2000
+#endif
+
+// A source that hasn't delivered a sample for this long (ms) no longer
+// blocks samples from less accurate sources
+#ifndef TIME_SYNC_SOURCE_TIMEOUT
+#define TIME_SYNC_SOURCE_TIMEOUT (15 * 60 * 1000)
+#endif
+
+// Shortest interval (ms) over which the clock drift is estimated
+#ifndef TIME_SYNC_DRIFT_INTERVAL
+#define TIME_SYNC_DRIFT_INTERVAL 60000
+#endif
+
+// Largest drift (ppm) attributed to the local oscillator
+#ifndef TIME_SYNC_MAX_DRIFT
+#define TIME_SYNC_MAX_DRIFT 500
+#endif
+
+// Sources of UTC time, from the least to the most accurate one
+enum TimeSource {
+  time_source_none,
+  time_source_server,  // the "hello" message of a Signal K server
+  time_source_sntp,    // the system clock, set by SNTP
+  time_source_gnss     // date and time of a GNSS fix
+};
+
+/**
+ * TimeSync maps the monotonic local clock (millis()) to UTC. It is fed
+ * with samples of the current UTC time from SNTP, a GNSS receiver or
+ * the Signal K server, and uses the most accurate source that is
+ * currently delivering samples.
+ *
+ * Small errors are corrected gradually, so that the latency jitter of
+ * the individual samples averages out, and the accumulated corrections
+ * are used to estimate the drift of the local oscillator. The mapping
+ * keeps running on the estimated drift when samples stop arriving.
+ *
+ * GNSS time can be fed by connecting NMEAData::datetime_ms to the
+ * TimeSync.
+ */
+class TimeSync : public Configurable, public ValueConsumer<int64_t> {
+ public:
+  TimeSync(String config_path);
+
+  /// Starts SNTP and the periodic tasks. Call after networking is set up.
+  void enable();
+
+  /**
+   * Adds a sample of the UTC time.
+   * @param utc_ms Milliseconds since the epoch
+   * @param monotonic_ms The monotonic_ms() at which the sample was valid
+   */
+  void add_sample(TimeSource source, int64_t utc_ms, uint64_t monotonic_ms);
+  void add_sample(TimeSource source, int64_t utc_ms) {
+    add_sample(source, utc_ms, monotonic_ms());
+  }
+
+  /**
+   * Adds a sample of the time of a GNSS fix, in milliseconds since the
+   * epoch. Several sentences report the same fix; only the first one,
+   * received with the least delay, is used.
+   */
+  virtual void set_input(int64_t input, uint8_t input_channel = 0) override;
+
+  /// Returns the milliseconds since boot, extended to 64 bits
+  uint64_t monotonic_ms();
+
+  /// Returns true once at least one sample has been received
+  bool is_synced() { return source != time_source_none; }
+
+  /// Converts a monotonic_ms() value to UTC milliseconds since the epoch
+  int64_t to_utc(uint64_t monotonic_ms);
+
+  /// Returns the current UTC time in milliseconds since the epoch
+  int64_t now() { return to_utc(monotonic_ms()); }
+
+  TimeSource get_source() { return source; }
+  float get_drift_ppm() { return drift_ppm; }
+
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
+  virtual bool set_configuration(const JsonObject& config) override final;
+  virtual PGM_P get_config_schema_P() override;
+
+ private:
+  String sntp_server = "pool.ntp.org";
+
+  // the mapping: base_utc at base_monotonic, advancing at 1 + drift
+  TimeSource source = time_source_none;
+  uint64_t base_monotonic = 0;
+  int64_t base_utc = 0;
+  float drift_ppm = 0;
+
+  uint64_t last_sample = 0;
+  int64_t last_gnss_time = 0;
+  // corrections applied since the drift was last updated
+  int64_t correction_sum = 0;
+  uint64_t drift_interval_start = 0;
+
+  // 64 bit extension of millis()
+  uint32_t last_millis = 0;
+  uint32_t millis_wraps = 0;
+
+  void step(TimeSource source, int64_t utc_ms, uint64_t monotonic_ms);
+  void poll_sntp();
+};
+
+#endif
@@ -19,7 +19,6 @@ JsonObject& AnalogVoltage::get_configuration(JsonBuffer& buf) {
   root["max_voltage"] = max_voltage;
   root["multiplier"] = multiplier;
   root["offset"] = offset;
-  root["value"] = output;
   return root;
 }
 
@@ -28,13 +27,12 @@ static const char SCHEMA[] PROGMEM = R"({
     "properties": {
         "max_voltage": { "title": "Max voltage", "type": "number", "description": "The maximum voltage allowed into your ESP's Analog Input pin" },
         "multiplier": { "title": "Mulitplier", "type": "number", "description": "Output will be multiplied by this before sending to SK" },
-        "offsest": { "title": "Offset", "type": "number", "description": "This will be added to output before sending to SK" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "offsest": { "title": "Offset", "type": "number", "description": "This will be added to output before sending to SK" }
     }
   })";
 
-String AnalogVoltage::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P AnalogVoltage::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool AnalogVoltage::set_configuration(const JsonObject& config) {
@@ -26,7 +26,6 @@ JsonObject& AngleCorrection::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["offset"] = offset;
   root["min_angle"] = min_angle;
-  root["value"] = output;
   return root;
 }
 
@@ -34,13 +33,12 @@ static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
         "offset": { "title": "Constant offset", "description": "Value to be added, in radians", "type": "number" },
-        "min_angle": { "title": "Minimum angle value", "description": "If you have output between -pi and pi, use -3.14159265, otherwise use 0.", "type": "number" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "min_angle": { "title": "Minimum angle value", "description": "If you have output between -pi and pi, use -3.14159265, otherwise use 0.", "type": "number" }
     }
   })###";
 
-String AngleCorrection::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P AngleCorrection::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool AngleCorrection::set_configuration(const JsonObject& config) {
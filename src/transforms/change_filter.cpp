@@ -55,8 +55,8 @@ static const char SCHEMA[] PROGMEM = R"({
   })";
 
 
-String ChangeFilter::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P ChangeFilter::get_config_schema_P() {
+  return SCHEMA;
 }
 
 
@@ -22,7 +22,7 @@ class ChangeFilter : public NumericTransform {
 
         virtual JsonObject& get_configuration(JsonBuffer& buf) override;
         virtual bool set_configuration(const JsonObject& config) override;
-        virtual String get_config_schema() override;
+        virtual PGM_P get_config_schema_P() override;
 
     protected:
         float minDelta;
@@ -96,8 +96,8 @@ static const char SCHEMA[] PROGMEM = R"({
     }
   })";
 
-String CurveInterpolator::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P CurveInterpolator::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool CurveInterpolator::set_configuration(const JsonObject& config) {
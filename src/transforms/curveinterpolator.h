@@ -35,7 +35,7 @@ class CurveInterpolator : public NumericTransform {
    // For reading and writing the configuration of this transformation
    virtual JsonObject& get_configuration(JsonBuffer& buf) override;
    virtual bool set_configuration(const JsonObject& config) override;
-   virtual String get_config_schema() override;
+   virtual PGM_P get_config_schema_P() override;
    
    // For manually adding sample points
    void clearSamples();
@@ -25,7 +25,6 @@ JsonObject& Difference::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["k1"] = k1;
   root["k2"] = k2;
-  root["value"] = output;
   return root;
 }
 
@@ -33,13 +32,12 @@ static const char SCHEMA[] PROGMEM = R"({
     "type": "object",
     "properties": {
         "k1": { "title": "Input #1 multiplier", "type": "number" },
-        "k2": { "title": "Input #2 multiplier", "type": "number" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "k2": { "title": "Input #2 multiplier", "type": "number" }
     }
   })";
 
-String Difference::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Difference::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool Difference::set_configuration(const JsonObject& config) {
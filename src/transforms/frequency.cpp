@@ -24,20 +24,18 @@ void Frequency::set_input(int input, uint8_t inputChannel) {
 JsonObject& Frequency::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["k"] = k;
-  root["value"] = output;
   return root;
 }
 
 static const char SCHEMA[] PROGMEM = R"###({
     "type": "object",
     "properties": {
-        "k": { "title": "Multiplier", "type": "number" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "k": { "title": "Multiplier", "type": "number" }
     }
   })###";
 
-String Frequency::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Frequency::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool Frequency::set_configuration(const JsonObject& config) {
@@ -14,7 +14,7 @@ class Frequency : public Transform<int, float> {
   virtual void enable() override;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
  private:
   float k;
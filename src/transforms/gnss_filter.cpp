@@ -0,0 +1,252 @@
+#include "gnss_filter.h"
+
+#include <math.h>
+
+#define METERS_PER_DEGREE_LAT 111120.0
+// the origin of the local plane is moved when the position gets this far
+// away from it (m), to keep the precision of the float state
+#define GNSS_FILTER_MAX_OFFSET 10000
+// initial standard deviation of the velocity (m/s)
+#define GNSS_FILTER_INITIAL_VELOCITY_SIGMA 10
+
+static const float H_EAST[GNSS_FILTER_STATES] = {1, 0, 0, 0};
+static const float H_NORTH[GNSS_FILTER_STATES] = {0, 1, 0, 0};
+static const float H_VEAST[GNSS_FILTER_STATES] = {0, 0, 1, 0};
+static const float H_VNORTH[GNSS_FILTER_STATES] = {0, 0, 0, 1};
+
+GNSSFilter::GNSSFilter(uint32_t output_interval, String config_path)
+    : Transform<Position, Position>(config_path),
+      output_interval{output_interval} {
+  className = "GNSSFilter";
+  load_configuration();
+}
+
+void GNSSFilter::enable() {
+  app.onRepeat(output_interval, [this]() { this->emit(); });
+}
+
+void GNSSFilter::reset(const Position& position) {
+  origin_latitude = position.latitude;
+  origin_longitude = position.longitude;
+  meters_per_degree_lon =
+      METERS_PER_DEGREE_LAT * cos(position.latitude * DEG_TO_RAD);
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    x[i] = 0;
+    for (int j = 0; j < GNSS_FILTER_STATES; j++) {
+      P[i][j] = 0;
+    }
+  }
+  P[0][0] = P[1][1] = position_sigma * position_sigma;
+  P[2][2] = P[3][3] =
+      GNSS_FILTER_INITIAL_VELOCITY_SIGMA * GNSS_FILTER_INITIAL_VELOCITY_SIGMA;
+  state_time = millis();
+  last_fix = state_time;
+  rejected = 0;
+  initialized = true;
+}
+
+void GNSSFilter::predict(uint32_t now) {
+  float dt = (now - state_time) / 1000.0;
+  state_time = now;
+  if (dt <= 0) {
+    return;
+  }
+  x[0] += x[2] * dt;
+  x[1] += x[3] * dt;
+  // P = F P F^T, with F moving the velocity rows into the positions
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < GNSS_FILTER_STATES; j++) {
+      P[i][j] += dt * P[i + 2][j];
+    }
+  }
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    for (int j = 0; j < 2; j++) {
+      P[i][j] += dt * P[i][j + 2];
+    }
+  }
+  // white noise acceleration
+  float q = acceleration_sigma * acceleration_sigma;
+  float dt2 = dt * dt;
+  for (int i = 0; i < 2; i++) {
+    P[i][i] += q * dt2 * dt2 / 4;
+    P[i][i + 2] += q * dt2 * dt / 2;
+    P[i + 2][i] += q * dt2 * dt / 2;
+    P[i + 2][i + 2] += q * dt2;
+  }
+}
+
+void GNSSFilter::update(const float H[GNSS_FILTER_STATES], float innovation,
+                        float r) {
+  // P H^T, which is also (H P)^T since P is symmetric
+  float PH[GNSS_FILTER_STATES];
+  float s = r;
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    PH[i] = 0;
+    for (int j = 0; j < GNSS_FILTER_STATES; j++) {
+      PH[i] += P[i][j] * H[j];
+    }
+  }
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    s += H[i] * PH[i];
+  }
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    x[i] += PH[i] / s * innovation;
+  }
+  for (int i = 0; i < GNSS_FILTER_STATES; i++) {
+    for (int j = 0; j < GNSS_FILTER_STATES; j++) {
+      P[i][j] -= PH[i] * PH[j] / s;
+    }
+  }
+}
+
+void GNSSFilter::set_input(Position input, uint8_t input_channel) {
+  if (isnan(input.latitude) || isnan(input.longitude)) {
+    return;
+  }
+  uint32_t now = millis();
+  // GGA and RMC both report the position of each fix
+  if (input.latitude == last_position.latitude &&
+      input.longitude == last_position.longitude &&
+      now - last_position_time < GNSS_FILTER_EPOCH_WINDOW) {
+    return;
+  }
+  last_position = input;
+  last_position_time = now;
+  altitude = input.altitude;
+  if (!initialized || now - last_fix > GNSS_FILTER_TIMEOUT) {
+    reset(input);
+    return;
+  }
+  update_position(input, now);
+}
+
+void GNSSFilter::update_position(const Position& position, uint32_t now) {
+  predict(now);
+  float east = (position.longitude - origin_longitude) * meters_per_degree_lon;
+  float north = (position.latitude - origin_latitude) * METERS_PER_DEGREE_LAT;
+  float r = position_sigma * position_sigma;
+  float de = east - x[0];
+  float dn = north - x[1];
+  float gate = GNSS_FILTER_GATE * GNSS_FILTER_GATE;
+  if (de * de > gate * (P[0][0] + r) || dn * dn > gate * (P[1][1] + r)) {
+    rejected++;
+    if (rejected >= GNSS_FILTER_MAX_REJECTED) {
+      debugW("GNSSFilter: position jumped, restarting");
+      reset(position);
+    }
+    return;
+  }
+  rejected = 0;
+  last_fix = now;
+  update(H_EAST, de, r);
+  update(H_NORTH, north - x[1], r);
+
+  if (fabs(x[0]) > GNSS_FILTER_MAX_OFFSET ||
+      fabs(x[1]) > GNSS_FILTER_MAX_OFFSET) {
+    origin_latitude += x[1] / METERS_PER_DEGREE_LAT;
+    origin_longitude += x[0] / meters_per_degree_lon;
+    meters_per_degree_lon =
+        METERS_PER_DEGREE_LAT * cos(origin_latitude * DEG_TO_RAD);
+    x[0] = x[1] = 0;
+  }
+}
+
+void GNSSFilter::set_input(ENUVector input, uint8_t input_channel) {
+  if (!initialized || isnan(input.east) || isnan(input.north)) {
+    return;
+  }
+  uint32_t now = millis();
+  // RMC and VTG both report the speed and course of each fix
+  if (input.east == last_velocity.east && input.north == last_velocity.north &&
+      now - last_velocity_time < GNSS_FILTER_EPOCH_WINDOW) {
+    return;
+  }
+  last_velocity = input;
+  last_velocity_time = now;
+  update_velocity(input.east, input.north, now);
+}
+
+void GNSSFilter::set_input(float input, uint8_t input_channel) {
+  if (initialized && !isnan(input)) {
+    update_heading(input, millis());
+  }
+}
+
+void GNSSFilter::update_velocity(float east, float north, uint32_t now) {
+  predict(now);
+  float r = velocity_sigma * velocity_sigma;
+  update(H_VEAST, east - x[2], r);
+  update(H_VNORTH, north - x[3], r);
+}
+
+void GNSSFilter::update_heading(float heading, uint32_t now) {
+  predict(now);
+  float v2 = x[2] * x[2] + x[3] * x[3];
+  if (v2 < GNSS_FILTER_MIN_HEADING_SPEED * GNSS_FILTER_MIN_HEADING_SPEED) {
+    return;
+  }
+  // the course atan2(ve, vn) linearized around the current velocity
+  float H[GNSS_FILTER_STATES] = {0, 0, x[3] / v2, -x[2] / v2};
+  float innovation = remainder(heading - atan2(x[2], x[3]), 2 * PI);
+  float sigma = heading_sigma * DEG_TO_RAD;
+  update(H, innovation, sigma * sigma);
+}
+
+void GNSSFilter::emit() {
+  uint32_t now = millis();
+  if (!initialized || now - last_fix > GNSS_FILTER_TIMEOUT) {
+    return;
+  }
+  // extrapolate to the current time without touching the state
+  float dt = (now - state_time) / 1000.0;
+  float east = x[0] + x[2] * dt;
+  float north = x[1] + x[3] * dt;
+  output.latitude = origin_latitude + north / METERS_PER_DEGREE_LAT;
+  output.longitude = origin_longitude + east / meters_per_degree_lon;
+  output.altitude = altitude;
+  notify();
+
+  velocity.set({x[2], x[3], 0});
+  speed.set(sqrt(x[2] * x[2] + x[3] * x[3]));
+  float cog = atan2(x[2], x[3]);
+  course.set(cog < 0 ? cog + 2 * PI : cog);
+}
+
+JsonObject& GNSSFilter::get_configuration(JsonBuffer& buf) {
+  JsonObject& root = buf.createObject();
+  root["output_interval"] = output_interval;
+  root["position_sigma"] = position_sigma;
+  root["velocity_sigma"] = velocity_sigma;
+  root["heading_sigma"] = heading_sigma;
+  root["acceleration_sigma"] = acceleration_sigma;
+  return root;
+}
+
+static const char SCHEMA[] PROGMEM = R"({
+    "type": "object",
+    "properties": {
+        "output_interval": { "title": "Output interval", "type": "integer", "description": "Interval (ms) at which the smoothed position is output. Takes effect after a restart." },
+        "position_sigma": { "title": "Position accuracy", "type": "number", "description": "Standard deviation of the GNSS position in m" },
+        "velocity_sigma": { "title": "Velocity accuracy", "type": "number", "description": "Standard deviation of the GNSS speed over ground in m/s" },
+        "heading_sigma": { "title": "Heading accuracy", "type": "number", "description": "Standard deviation of the heading as an indication of the course in degrees" },
+        "acceleration_sigma": { "title": "Acceleration", "type": "number", "description": "Typical acceleration of the vessel (m/s^2). Higher values follow maneuvers faster but smooth less." }
+    }
+  })";
+
+PGM_P GNSSFilter::get_config_schema_P() { return SCHEMA; }
+
+bool GNSSFilter::set_configuration(const JsonObject& config) {
+  String expected[] = {"output_interval", "position_sigma", "velocity_sigma",
+                       "heading_sigma", "acceleration_sigma"};
+  for (auto str : expected) {
+    if (!config.containsKey(str)) {
+      return false;
+    }
+  }
+  output_interval = config["output_interval"];
+  position_sigma = config["position_sigma"];
+  velocity_sigma = config["velocity_sigma"];
+  heading_sigma = config["heading_sigma"];
+  acceleration_sigma = config["acceleration_sigma"];
+  return true;
+}
@@ -0,0 +1,120 @@
+#ifndef _gnss_filter_H_
+#define _gnss_filter_H_
+
+#include "system/nmea_parser.h"
+#include "system/observablevalue.h"
+#include "transform.h"
+
+// Number of filter states: east, north, east velocity, north velocity
+#define GNSS_FILTER_STATES 4
+
+// The filter restarts from the next fix if no fix arrives for this
+// long (ms)
+#ifndef GNSS_FILTER_TIMEOUT
+#define GNSS_FILTER_TIMEOUT 10000
+#endif
+
+// Positions further off the estimate than this many standard deviations
+// are rejected as outliers
+#ifndef GNSS_FILTER_GATE
+#define GNSS_FILTER_GATE 5
+#endif
+
+// Consecutive positions rejected as outliers after which the filter
+// accepts that the position really has jumped and restarts
+#ifndef GNSS_FILTER_MAX_REJECTED
+#define GNSS_FILTER_MAX_REJECTED 3
+#endif
+
+// Identical measurements received within this time (ms) are considered
+// copies from different sentences of the same fix, e.g. GGA and RMC
+#ifndef GNSS_FILTER_EPOCH_WINDOW
+#define GNSS_FILTER_EPOCH_WINDOW 500
+#endif
+
+// The heading is only used above this speed (m/s)
+#ifndef GNSS_FILTER_MIN_HEADING_SPEED
+#define GNSS_FILTER_MIN_HEADING_SPEED 0.5
+#endif
+
+/**
+ * GNSSFilter is a Kalman filter that fuses the GNSS position with the
+ * velocity reported by the receiver into a smoothed position and
+ * velocity. Between fixes, the position is extrapolated with the
+ * estimated velocity, so that the output is emitted at a steady rate.
+ *
+ * The filter works in a local east/north plane around the first fix
+ * with a constant velocity model. All matrices have a fixed size, and
+ * the measurements are applied one scalar at a time, so no matrix
+ * inversion and no memory allocation is needed.
+ *
+ * Inputs:
+ * - Position: NMEAData::position
+ * - ENUVector: the velocity (m/s), NMEAData::ground_velocity, which
+ *   holds the speed and course over ground of one sentence, or
+ *   NMEAData::enu_velocity
+ * - float: optional true heading (rad). It steers the direction of the
+ *   velocity when the vessel is moving.
+ *
+ * The smoothed position is the output of the transform; the smoothed
+ * velocity is available in velocity, speed and course.
+ */
+class GNSSFilter : public Transform<Position, Position>,
+                   public ValueConsumer<ENUVector>,
+                   public ValueConsumer<float> {
+ public:
+  /// @param output_interval Interval (ms) at which the output is emitted
+  GNSSFilter(uint32_t output_interval = 200, String config_path = "");
+
+  virtual void enable() override;
+  virtual void set_input(Position input, uint8_t input_channel = 0) override;
+  virtual void set_input(ENUVector input, uint8_t input_channel = 0) override;
+  virtual void set_input(float input, uint8_t input_channel = 0) override;
+
+  ObservableValue<ENUVector> velocity;
+  ObservableValue<float> speed;
+  ObservableValue<float> course;
+
+  virtual JsonObject& get_configuration(JsonBuffer& buf) override;
+  virtual bool set_configuration(const JsonObject& config) override;
+  virtual PGM_P get_config_schema_P() override;
+
+ private:
+  uint32_t output_interval;
+  // standard deviations of the measurements and of the process noise
+  float position_sigma = 3;      // m
+  float velocity_sigma = 0.3;    // m/s
+  float heading_sigma = 10;      // degrees
+  float acceleration_sigma = 0.5;  // m/s^2
+
+  bool initialized = false;
+  // origin of the local plane
+  double origin_latitude;
+  double origin_longitude;
+  double meters_per_degree_lon;
+  float altitude;
+  // state and covariance at state_time
+  float x[GNSS_FILTER_STATES];
+  float P[GNSS_FILTER_STATES][GNSS_FILTER_STATES];
+  uint32_t state_time;
+  uint32_t last_fix;
+  int rejected = 0;
+
+  // the last measurements, to skip the copies reported by several
+  // sentences of the same epoch
+  Position last_position = {NAN, NAN, NAN};
+  uint32_t last_position_time = 0;
+  ENUVector last_velocity = {NAN, NAN, NAN};
+  uint32_t last_velocity_time = 0;
+
+  void reset(const Position& position);
+  void predict(uint32_t now);
+  /// Applies a scalar measurement with the row H and the variance r
+  void update(const float H[GNSS_FILTER_STATES], float innovation, float r);
+  void update_position(const Position& position, uint32_t now);
+  void update_velocity(float east, float north, uint32_t now);
+  void update_heading(float heading, uint32_t now);
+  void emit();
+};
+
+#endif
@@ -0,0 +1,12 @@
+#include "gnss_quality_string.h"
+
+
+GNSSQualityString::GNSSQualityString(String config_path) :
+    Transform<GNSSQuality, String>(config_path) {
+      className = "GNSSQualityString";
+}
+
+void GNSSQualityString::set_input(GNSSQuality input, uint8_t inputChannel) {
+  output = gnss_quality_name(input);
+  notify();
+}
@@ -0,0 +1,20 @@
+#ifndef _gnss_quality_string_H_
+#define _gnss_quality_string_H_
+
+#include "transform.h"
+#include "system/nmea_parser.h"
+
+/**
+ * GNSSQualityString consumes a GNSSQuality and produces its human
+ * readable name, e.g. for navigation.methodQuality. The names are kept
+ * in flash; a String is only built when the quality changes.
+ */
+class GNSSQualityString : public Transform<GNSSQuality, String> {
+
+ public:
+  GNSSQualityString(String config_path="");
+  virtual void set_input(GNSSQuality input, uint8_t inputChannel = 0) override;
+
+};
+
+#endif
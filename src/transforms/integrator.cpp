@@ -10,14 +10,21 @@ Integrator::Integrator(float k, float value, String config_path) :
   className = "Integrator";
   output = value;
   load_configuration();
+  saved_value = output;
 }
 
 
 void Integrator::enable() {
-  // save the integrator value every 10 s
-  // NOTE: Disabled for now because interrupts start throwing
-  // exceptions.
-  //app.onRepeat(10000, [this](){ this->save_configuration(); });
+  // save the integrated value periodically; the config store writes it
+  // from the main loop, together with other changes
+  if (config_path != "") {
+    app.onRepeat(INTEGRATOR_SAVE_INTERVAL, [this](){
+      if (output != saved_value) {
+        saved_value = output;
+        this->save_configuration();
+      }
+    });
+  }
 }
 
 void Integrator::set_input(float input, uint8_t inputChannel) {
@@ -41,8 +48,8 @@ static const char SCHEMA[] PROGMEM = R"({
     }
   })";
 
-String Integrator::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Integrator::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool Integrator::set_configuration(const JsonObject& config) {
@@ -3,6 +3,11 @@
 
 #include "transform.h"
 
+// Interval (ms) at which a changed value is saved
+#ifndef INTEGRATOR_SAVE_INTERVAL
+#define INTEGRATOR_SAVE_INTERVAL 10000
+#endif
+
 // y = k * sum(x_t)
 class Integrator : public NumericTransform {
  public:
@@ -11,10 +16,11 @@ class Integrator : public NumericTransform {
   virtual void set_input(float input, uint8_t inputChannel = 0) override final;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override final;
   virtual bool set_configuration(const JsonObject& config) override final;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
  private:
   float k;
+  float saved_value;
 };
 
 #endif
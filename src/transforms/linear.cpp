@@ -21,7 +21,6 @@ JsonObject& Linear::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["k"] = k;
   root["c"] = c;
-  root["value"] = output;
   return root;
 }
 
@@ -29,13 +28,12 @@ static const char SCHEMA[] PROGMEM = R"({
     "type": "object",
     "properties": {
         "k": { "title": "Multiplier", "type": "number" },
-        "c": { "title": "Constant offset", "type": "number" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "c": { "title": "Constant offset", "type": "number" }
     }
   })";
 
-String Linear::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Linear::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool Linear::set_configuration(const JsonObject& config) {
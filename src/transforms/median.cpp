@@ -37,8 +37,8 @@ static const char SCHEMA[] PROGMEM = R"({
     }
   })";
 
-String Median::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P Median::get_config_schema_P() {
+  return SCHEMA;
 }
 
 
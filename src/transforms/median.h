@@ -17,7 +17,7 @@ class Median : public NumericTransform {
   virtual void set_input(float input, uint8_t inputChannel = 0) override;
   virtual JsonObject& get_configuration(JsonBuffer& buf) override;
   virtual bool set_configuration(const JsonObject& config) override;
-  virtual String get_config_schema() override;
+  virtual PGM_P get_config_schema_P() override;
 
  private:
   std::vector<float> buf;
@@ -38,7 +38,6 @@ JsonObject& MovingAverage::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["k"] = k;
   root["n"] = n;
-  root["value"] = output;
   return root;
 }
 
@@ -46,13 +45,12 @@ static const char SCHEMA[] PROGMEM = R"({
     "type": "object",
     "properties": {
         "n": { "title": "Number of samples in average", "type": "integer" },
-        "k": { "title": "Multiplier", "type": "number" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "k": { "title": "Multiplier", "type": "number" }
     }
   })";
 
-String MovingAverage::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P MovingAverage::get_config_schema_P() {
+  return SCHEMA;
 }
 
 
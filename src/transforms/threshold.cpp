@@ -22,7 +22,6 @@ JsonObject& NumericThreshold::get_configuration(JsonBuffer& buf)
     root["min"] = minValue;
     root["max"] = maxValue;
     root["in_range"] = inRange;
-    root["value"] = output;
     return root;
 }
 
@@ -31,14 +30,13 @@ static const char NUMERIC_SCHEMA[] PROGMEM = R"({
     "properties": {
         "min": { "title": "Minimum value", "type": "number", "description" : "Minimum value to be 'in range'" },
         "max": { "title": "Maximum value", "type": "number", "description" : "Maximum value to be 'in range'" },
-        "in_range": { "title": "In range value", "type": "boolean", "description" : "Output value when input value is 'in range'" },
-        "value": { "title": "Last value", "type" : "boolean", "readOnly": true }
+        "in_range": { "title": "In range value", "type": "boolean", "description" : "Output value when input value is 'in range'" }
     }
   })";
 
   bool NumericThreshold::set_configuration(const JsonObject& config)
   {
-      String expected[] = {"min", "max", "in_range", "value"};
+      String expected[] = {"min", "max", "in_range"};
       for (auto str : expected) {
         if (!config.containsKey(str)) {
           return false;
@@ -47,14 +45,13 @@ static const char NUMERIC_SCHEMA[] PROGMEM = R"({
       minValue = config["min"];
       maxValue = config["max"];
       inRange = config["in_range"];
-      output = config["value"];
 
       return true;
   }
 
-  String NumericThreshold::get_config_schema()
+  PGM_P NumericThreshold::get_config_schema_P()
   {
-    return FPSTR(NUMERIC_SCHEMA);
+    return NUMERIC_SCHEMA;
   }
 
 
@@ -64,7 +61,6 @@ static const char NUMERIC_SCHEMA[] PROGMEM = R"({
       root["min"] = minValue;
       root["max"] = maxValue;
       root["in_range"] = inRange;
-      root["value"] = output;
       return root;
   }
 
@@ -73,8 +69,7 @@ static const char NUMERIC_SCHEMA[] PROGMEM = R"({
       "properties": {
           "min": { "title": "Minimum value", "type": "number", "description" : "Minimum value to be 'in range'" },
           "max": { "title": "Maximum value", "type": "number", "description" : "Maximum value to be 'in range'" },
-          "in_range": { "title": "In range value", "type": "boolean", "description" : "Output value when input value is 'in range'" },
-          "value": { "title": "Last value", "type" : "boolean", "readOnly": true }
+          "in_range": { "title": "In range value", "type": "boolean", "description" : "Output value when input value is 'in range'" }
       }
     })";
 
@@ -89,12 +84,11 @@ static const char NUMERIC_SCHEMA[] PROGMEM = R"({
       minValue = config["min"];
       maxValue = config["max"];
       inRange = config["in_range"];
-      output = config["value"];
 
       return true;
   }
 
-  String IntegerThreshold::get_config_schema()
+  PGM_P IntegerThreshold::get_config_schema_P()
   {
-    return FPSTR(INTEGER_SCHEMA);
+    return INTEGER_SCHEMA;
   }
\ No newline at end of file
@@ -41,7 +41,7 @@ class NumericThreshold : public ThresholdTransform<float, bool>
 
     virtual JsonObject& get_configuration(JsonBuffer& buf) override;
     virtual bool set_configuration(const JsonObject& config) override;
-    virtual String get_config_schema() override;
+    virtual PGM_P get_config_schema_P() override;
 };
 
 /**
@@ -58,6 +58,6 @@ class IntegerThreshold : public ThresholdTransform<int, bool>
 
     virtual JsonObject& get_configuration(JsonBuffer& buf) override;
     virtual bool set_configuration(const JsonObject& config) override;
-    virtual String get_config_schema() override;
+    virtual PGM_P get_config_schema_P() override;
 };
 #endif
\ No newline at end of file
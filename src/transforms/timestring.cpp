@@ -1,6 +1,8 @@
 
 #include "timestring.h"
 
+#include "system/iso8601.h"
+
 
 TimeString::TimeString(String config_path) :
     Transform<time_t, String>(config_path) {
@@ -8,8 +10,8 @@ TimeString::TimeString(String config_path) :
 }
 
 void TimeString::set_input(time_t input, uint8_t inputChannel) {
-  char buf[sizeof "2011-10-08T07:07:09Z"];
-  strftime(buf, sizeof buf, "%FT%TZ", gmtime(&input));
+  char buf[ISO8601_BUFFER_SIZE];
+  format_iso8601(buf, (int64_t)input * 1000, false);
   output = String(buf);
   notify();
 }
@@ -11,6 +11,7 @@
 #include "system/valueconsumer.h"
 #include "system/valueproducer.h"
 #include "system/enable.h"
+#include "system/live_values.h"
 #include "sensesp.h"
 
 
@@ -58,6 +59,10 @@ class Transform : public TransformBase,
          ValueConsumer<C>(), 
          ValueProducer<P>() {
            className = "Transform";
+           if (config_path != "") {
+             live_values.add(this->config_path.c_str(),
+                             static_cast<ValueProducer<P>*>(this));
+           }
       }
 
 
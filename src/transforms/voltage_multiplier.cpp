@@ -15,7 +15,6 @@ JsonObject& VoltageMultiplier::get_configuration(JsonBuffer& buf) {
   JsonObject& root = buf.createObject();
   root["R1"] = R1;
   root["R2"] = R2;
-  root["value"] = output;
   return root;
   };
 
@@ -23,14 +22,13 @@ JsonObject& VoltageMultiplier::get_configuration(JsonBuffer& buf) {
     "type": "object",
     "properties": {
         "R1": { "title": "R1", "type": "number", "description": "The measured value of resistor R1" },
-        "R2": { "title": "R2", "type": "number", "description": "The measured value of resistor R2" },
-        "value": { "title": "Last value", "type" : "number", "readOnly": true }
+        "R2": { "title": "R2", "type": "number", "description": "The measured value of resistor R2" }
     }
   })###";
 
 
-  String VoltageMultiplier::get_config_schema() {
-  return FPSTR(SCHEMA);
+  PGM_P VoltageMultiplier::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool VoltageMultiplier::set_configuration(const JsonObject& config) {
@@ -31,7 +31,7 @@ class VoltageMultiplier : public NumericTransform {
         uint16_t R2;
         virtual JsonObject& get_configuration(JsonBuffer& buf) override;
         virtual bool set_configuration(const JsonObject& config) override;
-        virtual String get_config_schema() override;
+        virtual PGM_P get_config_schema_P() override;
 };
 
 #endif
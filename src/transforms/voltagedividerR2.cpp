@@ -27,8 +27,8 @@ static const char SCHEMA[] PROGMEM = R"({
     }
   })";
 
-String VoltageDividerR2::get_config_schema() {
-  return FPSTR(SCHEMA);
+PGM_P VoltageDividerR2::get_config_schema_P() {
+  return SCHEMA;
 }
 
 bool VoltageDividerR2::set_configuration(const JsonObject& config) {
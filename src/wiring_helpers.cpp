@@ -8,6 +8,7 @@
 #include "sensors/digital_input.h"
 #include "transforms/angle_correction.h"
 #include "transforms/frequency.h"
+#include "transforms/gnss_quality_string.h"
 #include "signalk/signalk_output.h"
 #include "signalk/signalk_position.h"
 #include "signalk/signalk_time.h"
@@ -77,12 +78,13 @@ void setup_fuel_flow_meter(
 }
 
 
-GPSInput* setup_gps(Stream* rx_stream) {
+GPSInput* setup_gps(Stream* rx_stream, HeadingSource heading_source) {
   GPSInput* gps = new GPSInput(rx_stream);
   gps->nmea_data.position
     .connectTo(new SKOutputPosition("navigation.position", ""));
   gps->nmea_data.gnss_quality
-    .connectTo(new SKOutputString("navigation.methodQuality", ""));
+    .connectTo(new GNSSQualityString())
+    ->connectTo(new SKOutputString("navigation.methodQuality", ""));
   gps->nmea_data.num_satellites
     .connectTo(new SKOutputInt("navigation.satellites", ""));
   gps->nmea_data.horizontal_dilution
@@ -95,12 +97,20 @@ GPSInput* setup_gps(Stream* rx_stream) {
     .connectTo(new SKOutputNumber("navigation.differentialReference", ""));
   gps->nmea_data.datetime
     .connectTo(new SKOutputTime("navigation.datetime", ""));
+  if (sensesp_app != nullptr) {
+    // use the GNSS time for timestamping the deltas
+    gps->nmea_data.datetime_ms.connectTo(sensesp_app->get_time_sync());
+  }
   gps->nmea_data.speed
     .connectTo(new SKOutputNumber("navigation.speedOverGround", ""));
   gps->nmea_data.true_course
     .connectTo(new SKOutputNumber("navigation.courseOverGroundTrue", ""));
   gps->nmea_data.variation
     .connectTo(new SKOutputNumber("navigation.magneticVariation", ""));
+  gps->nmea_data.magnetic_course
+    .connectTo(new SKOutputNumber("navigation.courseOverGroundMagnetic", ""));
+  gps->nmea_data.position_dilution
+    .connectTo(new SKOutputNumber("navigation.positionDilution", ""));
   gps->nmea_data.rtk_age
     .connectTo(new SKOutputNumber("navigation.rtkAge", ""));
   gps->nmea_data.rtk_ratio
@@ -108,9 +118,18 @@ GPSInput* setup_gps(Stream* rx_stream) {
   gps->nmea_data.baseline_length
     .connectTo(new SKOutputNumber("navigation.rtkBaselineLength", ""));
   gps->nmea_data.baseline_course
-    .connectTo(new SKOutputNumber("navigation.rtkBaselineCourse"))
-    ->connectTo(new AngleCorrection(0, 0, "/sensors/heading/correction"))
-    ->connectTo(new SKOutputNumber("navigation.headingTrue", ""));
+    .connectTo(new SKOutputNumber("navigation.rtkBaselineCourse"));
+  // navigation.headingTrue has a single source. Each source has a
+  // correction of its own, since their offsets are unrelated.
+  if (heading_source == heading_from_hdt) {
+    gps->nmea_data.heading_true
+      .connectTo(new AngleCorrection(0, 0, "/sensors/hdt/correction"))
+      ->connectTo(new SKOutputNumber("navigation.headingTrue", ""));
+  } else {
+    gps->nmea_data.baseline_course
+      .connectTo(new AngleCorrection(0, 0, "/sensors/heading/correction"))
+      ->connectTo(new SKOutputNumber("navigation.headingTrue", ""));
+  }
 
   return gps;
 }
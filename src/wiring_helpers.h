@@ -15,7 +15,13 @@ void setup_fuel_flow_meter(
   int return_flow_pin
 );
 
-GPSInput* setup_gps(Stream* rx_stream);
+// The sentence that provides navigation.headingTrue: the course of the
+// RTK baseline between two antennas, or the HDT heading of e.g. a
+// compass or a dual-antenna receiver
+enum HeadingSource { heading_from_baseline, heading_from_hdt };
+
+GPSInput* setup_gps(Stream* rx_stream,
+                    HeadingSource heading_source = heading_from_baseline);
 
 //Obsolete
 void setup_onewire_temperature(
@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "sensesp.h"
+#include "system/config_store.h"
+#include "system/configurable.h"
+#include "system/storage.h"
+
+class TestConfigurable : public Configurable {
+ public:
+  TestConfigurable(String config_path) : Configurable(config_path) {}
+  int value = 0;
+
+  JsonObject& get_configuration(JsonBuffer& buf) override {
+    JsonObject& root = buf.createObject();
+    root["value"] = value;
+    return root;
+  }
+  bool set_configuration(const JsonObject& config) override {
+    value = config["value"];
+    return true;
+  }
+};
+
+/// A storage on which no file can be written while read_only is set
+class ReadOnlyStorage : public RAMStorage {
+ public:
+  bool read_only = true;
+
+  std::unique_ptr<Stream> open(const String& path, const char* mode) override {
+    if (read_only && mode[0] == 'w') {
+      return nullptr;
+    }
+    return RAMStorage::open(path, mode);
+  }
+};
+
+static void write_file(Storage* to, const String& path, const String& data) {
+  auto f = to->open(path, "w");
+  TEST_ASSERT_TRUE(f != nullptr);
+  f->print(data);
+}
+
+/// @return The value saved for config_path in store, -1 if there is none
+static int read_value(ConfigStore& store, const String& config_path) {
+  String json;
+  if (!store.read(config_path, json)) {
+    return -1;
+  }
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& obj = jsonBuffer.parseObject(json);
+  return obj.success() ? obj["value"].as<int>() : -1;
+}
+
+void test_flush_and_load() {
+  RAMStorage ram;
+  storage = &ram;
+  TestConfigurable configurable("/test/flush");
+  ConfigStore writer;
+  configurable.value = 42;
+  writer.save(&configurable);
+  writer.flush();
+
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(42, read_value(reader, "/test/flush"));
+  TEST_ASSERT_EQUAL(-1, read_value(reader, "/test/missing"));
+}
+
+void test_damaged_copy_falls_back() {
+  RAMStorage ram;
+  storage = &ram;
+  TestConfigurable configurable("/test/fallback");
+  ConfigStore writer;
+  configurable.value = 1;
+  writer.save(&configurable);
+  writer.flush();
+  configurable.value = 2;
+  writer.save(&configurable);
+  writer.flush();
+
+  // the store is written to the slots in turn, starting with A when it
+  // is created; the newest copy is in A again
+  write_file(&ram, CONFIG_STORE_SLOT_A, "SKCFG 3 00000000 10\n{\"/test/fa");
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(1, read_value(reader, "/test/fallback"));
+}
+
+void test_failed_write_retried() {
+  ReadOnlyStorage flash;
+  storage = &flash;
+  TestConfigurable configurable("/test/retry");
+  ConfigStore writer;
+  configurable.value = 4;
+  writer.save(&configurable);
+  writer.flush();
+  TEST_ASSERT_FALSE(flash.exists(CONFIG_STORE_SLOT_A));
+
+  // nothing has changed since, but the failed write is repeated
+  flash.read_only = false;
+  writer.flush();
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(4, read_value(reader, "/test/retry"));
+}
+
+void test_damaged_copies_set_aside() {
+  RAMStorage ram;
+  storage = &ram;
+  TestConfigurable configurable("/test/damaged");
+  TestConfigurable other("/test/other");
+  // the newest copy parses despite a damaged CRC, the older one doesn't
+  write_file(&ram, CONFIG_STORE_SLOT_A,
+             "SKCFG 2 00000000 46\n"
+             "{\"/test/damaged\":{\"value\":7},\"/test/other\":{}}");
+  write_file(&ram, CONFIG_STORE_SLOT_B, "SKCFG 1 00000000 10\n{\"/test/da");
+
+  ConfigStore store;
+  TEST_ASSERT_EQUAL(7, read_value(store, "/test/damaged"));
+  TEST_ASSERT_TRUE(ram.exists(CONFIG_STORE_SLOT_A ".bad"));
+  TEST_ASSERT_TRUE(ram.exists(CONFIG_STORE_SLOT_B ".bad"));
+  other.value = 3;
+  store.save(&other);
+  store.flush();
+
+  // the salvaged configuration is kept along with the change
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(7, read_value(reader, "/test/damaged"));
+  TEST_ASSERT_EQUAL(3, read_value(reader, "/test/other"));
+  TEST_ASSERT_TRUE(ram.exists(CONFIG_STORE_SLOT_B ".bad"));
+}
+
+void test_legacy_files() {
+  RAMStorage ram;
+  storage = &ram;
+  write_file(&ram, "/test/legacy", "{\"value\":5}");
+  write_file(&ram, "/user/data.json", "{\"value\":6}");
+  write_file(&ram, "/user/notes.txt", "not JSON");
+  TestConfigurable configurable("/test/legacy");
+
+  ConfigStore store;
+  TEST_ASSERT_EQUAL(5, read_value(store, "/test/legacy"));
+  store.flush();
+  // only the file of a Configurable is removed
+  TEST_ASSERT_FALSE(ram.exists("/test/legacy"));
+  TEST_ASSERT_TRUE(ram.exists("/user/data.json"));
+  TEST_ASSERT_TRUE(ram.exists("/user/notes.txt"));
+
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(5, read_value(reader, "/test/legacy"));
+}
+
+void test_copy_files() {
+  RAMStorage from;
+  write_file(&from, "/a", "first");
+  write_file(&from, "/dir/b", "second");
+  RAMStorage to;
+  TEST_ASSERT_TRUE(copy_files(&from, &to));
+  auto f = to.open("/dir/b", "r");
+  TEST_ASSERT_TRUE(f != nullptr);
+  TEST_ASSERT_EQUAL_STRING("second", f->readString().c_str());
+
+  ReadOnlyStorage read_only;
+  TEST_ASSERT_FALSE(copy_files(&from, &read_only));
+}
+
+void test_import_legacy_from_copy() {
+  // the files couldn't be written back to the formatted file system
+  RAMStorage* copy = new RAMStorage();
+  write_file(copy, "/test/copied", "{\"value\":7}");
+  RAMStorage ram;
+  storage = &ram;
+  TestConfigurable configurable("/test/copied");
+
+  ConfigStore store;
+  store.import_legacy_from(copy);
+  TEST_ASSERT_EQUAL(7, read_value(store, "/test/copied"));
+
+  ConfigStore reader;
+  TEST_ASSERT_EQUAL(7, read_value(reader, "/test/copied"));
+}
+
+ReactESP app([]() {
+  delay(2000);
+  UNITY_BEGIN();
+  RUN_TEST(test_flush_and_load);
+  RUN_TEST(test_damaged_copy_falls_back);
+  RUN_TEST(test_damaged_copies_set_aside);
+  RUN_TEST(test_failed_write_retried);
+  RUN_TEST(test_legacy_files);
+  RUN_TEST(test_copy_files);
+  RUN_TEST(test_import_legacy_from_copy);
+  UNITY_END();
+  storage = nullptr;
+});
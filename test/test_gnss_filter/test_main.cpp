@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "sensesp.h"
+#include "system/nmea_parser.h"
+#include "transforms/gnss_filter.h"
+
+// A vessel heading east at a steady speed reports a fix every
+// EPOCH_INTERVAL ms, each as GGA, RMC and VTG, like a typical receiver.
+// The fixes are replayed in real time through the parser into the
+// filter.
+#define EPOCH_INTERVAL 200
+#define NUM_EPOCHS 50
+#define START_LATITUDE 60.15
+#define START_LONGITUDE 24.95
+#define SPEED 5.0  // m/s
+#define METERS_PER_DEGREE_LAT 111120.0
+
+static NMEAData nmea_data;
+static NMEAParser nmea_parser;
+static GNSSFilter* filter;
+static int epoch = 0;
+static uint32_t start_time;
+
+// Feeds a sentence with its checksum and CR LF appended
+static void feed(const char* body) {
+  uint8_t checksum = 0;
+  for (const char* p = body; *p != 0; p++) {
+    checksum ^= *p;
+  }
+  char sentence[128];
+  snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+  nmea_parser.handle(sentence, strlen(sentence));
+}
+
+// Formats an unsigned latitude or longitude as (d)ddmm.mmmmmm
+static void format_latlon(char* buf, size_t size, double value,
+                          int degree_digits) {
+  int degrees = (int)value;
+  double minutes = (value - degrees) * 60;
+  snprintf(buf, size, "%0*d%09.6f", degree_digits, degrees, minutes);
+}
+
+// Deterministic position noise of up to 1 m
+static double noise(int i, int seed) {
+  return ((i * seed) % 11 - 5) * 0.2;
+}
+
+static double meters_per_degree_lon() {
+  return METERS_PER_DEGREE_LAT * cos(START_LATITUDE * DEG_TO_RAD);
+}
+
+static void replay_epoch() {
+  float t = epoch * EPOCH_INTERVAL / 1000.0;
+  double east = SPEED * t + noise(epoch, 7919);
+  double north = noise(epoch, 104729);
+  char lat[16], lon[16];
+  format_latlon(lat, sizeof(lat),
+                START_LATITUDE + north / METERS_PER_DEGREE_LAT, 2);
+  format_latlon(lon, sizeof(lon),
+                START_LONGITUDE + east / meters_per_degree_lon(), 3);
+  char time[16];
+  snprintf(time, sizeof(time), "1200%05.2f", t);
+  float knots = SPEED * 3600 / 1852;
+
+  char body[100];
+  snprintf(body, sizeof(body),
+           "GPGGA,%s,%s,N,%s,E,1,10,0.8,12.0,M,18.0,M,,", time, lat, lon);
+  feed(body);
+  snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,%s,E,%.3f,90.0,181026,,,A",
+           time, lat, lon, knots);
+  feed(body);
+  snprintf(body, sizeof(body), "GPVTG,90.0,T,,M,%.3f,N,%.3f,K,A", knots,
+           knots * 1.852);
+  feed(body);
+  epoch++;
+}
+
+void test_replay_parsed() {
+  TEST_ASSERT_EQUAL(3 * NUM_EPOCHS, nmea_parser.get_counters().sentences);
+  TEST_ASSERT_EQUAL(0, nmea_parser.get_counters().parse_failures);
+}
+
+void test_replay_velocity() {
+  TEST_ASSERT_FLOAT_WITHIN(0.2, SPEED, filter->speed.get());
+  TEST_ASSERT_FLOAT_WITHIN(0.02, PI / 2, filter->course.get());
+  TEST_ASSERT_FLOAT_WITHIN(0.2, 0, filter->velocity.get().north);
+}
+
+void test_replay_position() {
+  // the output is extrapolated to the time it was emitted, which is at
+  // most an output interval ago
+  float t = (millis() - start_time) / 1000.0;
+  Position position = filter->get();
+  double east = (position.longitude - START_LONGITUDE) *
+                meters_per_degree_lon();
+  double north = (position.latitude - START_LATITUDE) * METERS_PER_DEGREE_LAT;
+  TEST_ASSERT_FLOAT_WITHIN(1.5, SPEED * t, east);
+  TEST_ASSERT_FLOAT_WITHIN(1.5, 0, north);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, 12.0, position.altitude);
+}
+
+ReactESP app([]() {
+  delay(2000);
+  UNITY_BEGIN();
+
+  nmea_parser.add_sentence_parser(new GGASentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new RMCSentenceParser(&nmea_data));
+  nmea_parser.add_sentence_parser(new VTGSentenceParser(&nmea_data));
+  filter = new GNSSFilter(100);
+  nmea_data.position.connectTo(filter);
+  nmea_data.ground_velocity.connectTo(filter);
+  filter->enable();
+
+  start_time = millis();
+  replay_epoch();
+  app.onRepeat(EPOCH_INTERVAL, []() {
+    if (epoch < NUM_EPOCHS) {
+      replay_epoch();
+      if (epoch == NUM_EPOCHS) {
+        // check between two epochs, after an output has been emitted
+        app.onDelay(EPOCH_INTERVAL / 2, []() {
+          RUN_TEST(test_replay_parsed);
+          RUN_TEST(test_replay_velocity);
+          RUN_TEST(test_replay_position);
+          UNITY_END();
+        });
+      }
+    }
+  });
+});
@@ -0,0 +1,283 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "sensesp.h"
+#include "system/nmea_parser.h"
+
+// The field parsers as they were before they were rewritten without
+// sscanf, with the sign of parse_NS/parse_EW fixed. They are the golden
+// reference for the values and the baseline of the benchmark.
+
+static bool sscanf_parse_int(int* value, char* s) {
+  return sscanf(s, "%d", value) == 1;
+}
+
+static bool sscanf_parse_float(float* value, char* s) {
+  return sscanf(s, "%f", value) == 1;
+}
+
+static bool sscanf_parse_double(double* value, char* s) {
+  return sscanf(s, "%lf", value) == 1;
+}
+
+static bool sscanf_parse_latlon(double* value, char* s) {
+  double degmin;
+  if (sscanf(s, "%lf", &degmin) != 1) {
+    return false;
+  }
+  int degrees = degmin / 100;
+  double minutes = degmin - 100 * degrees;
+  *value = degrees + minutes / 60;
+  return true;
+}
+
+static bool sscanf_parse_time(int* hour, int* minute, float* second,
+                              char* s) {
+  return sscanf(s, "%2d%2d%f", hour, minute, second) == 3;
+}
+
+static bool sscanf_parse_date(int* year, int* month, int* day, char* s) {
+  int retval = sscanf(s, "%2d%2d%2d", day, month, year);
+  *year += 100;
+  *month -= 1;
+  return retval == 3;
+}
+
+// Fields as sent by GNSS receivers
+static const char* const int_fields[] = {"0", "7", "08", "-12", "+3",
+                                         "123456"};
+static const char* const decimal_fields[] = {
+    "0",     "0.9",   "545.4",    "-12.5",    "46.9",     "0.0001",
+    "173.8", "231.8", "004.2",    "1.234567", "99999.99", "-0.0",
+    "10.",   ".5",    "0.000123", "1852.0",   "360.00"};
+static const char* const latlon_fields[] = {
+    "4807.038",       "01131.000",     "5133.82",   "00042.24",
+    "6009.123456789", "17959.9999999", "0000.0000", "8959.99999"};
+static const char* const time_fields[] = {"123519", "220516.25", "000000.00",
+                                          "235959.99", "120003.5"};
+static const char* const date_fields[] = {"130694", "181026", "010100",
+                                          "311299"};
+
+#define NUM(a) (sizeof(a) / sizeof(a[0]))
+
+// Copies a field; the parsers take a writable buffer
+static char* field(char* buf, const char* s) {
+  strcpy(buf, s);
+  return buf;
+}
+
+void test_int_matches_sscanf() {
+  char buf[32];
+  for (size_t i = 0; i < NUM(int_fields); i++) {
+    int expected = -1, value = -1;
+    TEST_ASSERT_TRUE(sscanf_parse_int(&expected, field(buf, int_fields[i])));
+    TEST_ASSERT_TRUE(parse_int(&value, field(buf, int_fields[i])));
+    TEST_ASSERT_EQUAL(expected, value);
+  }
+}
+
+void test_decimal_matches_sscanf() {
+  char buf[32];
+  for (size_t i = 0; i < NUM(decimal_fields); i++) {
+    double expected = NAN, value = NAN;
+    TEST_ASSERT_TRUE(
+        sscanf_parse_double(&expected, field(buf, decimal_fields[i])));
+    TEST_ASSERT_TRUE(parse_double(&value, field(buf, decimal_fields[i])));
+    TEST_ASSERT_EQUAL_DOUBLE(expected, value);
+
+    float expected_f = NAN, value_f = NAN;
+    TEST_ASSERT_TRUE(
+        sscanf_parse_float(&expected_f, field(buf, decimal_fields[i])));
+    TEST_ASSERT_TRUE(parse_float(&value_f, field(buf, decimal_fields[i])));
+    TEST_ASSERT_EQUAL_FLOAT(expected_f, value_f);
+  }
+}
+
+void test_latlon_matches_sscanf() {
+  char buf[32];
+  for (size_t i = 0; i < NUM(latlon_fields); i++) {
+    double expected = NAN, value = NAN;
+    TEST_ASSERT_TRUE(
+        sscanf_parse_latlon(&expected, field(buf, latlon_fields[i])));
+    TEST_ASSERT_TRUE(parse_latlon(&value, field(buf, latlon_fields[i])));
+    // the old split into degrees and minutes lost some precision; 1e-10
+    // degrees is about 0.01 mm
+    TEST_ASSERT_DOUBLE_WITHIN(1e-10, expected, value);
+  }
+}
+
+void test_time_and_date_match_sscanf() {
+  char buf[32];
+  for (size_t i = 0; i < NUM(time_fields); i++) {
+    int hour, minute, expected_hour, expected_minute;
+    float second, expected_second;
+    TEST_ASSERT_TRUE(sscanf_parse_time(&expected_hour, &expected_minute,
+                                       &expected_second,
+                                       field(buf, time_fields[i])));
+    TEST_ASSERT_TRUE(
+        parse_time(&hour, &minute, &second, field(buf, time_fields[i])));
+    TEST_ASSERT_EQUAL(expected_hour, hour);
+    TEST_ASSERT_EQUAL(expected_minute, minute);
+    TEST_ASSERT_EQUAL_FLOAT(expected_second, second);
+  }
+  for (size_t i = 0; i < NUM(date_fields); i++) {
+    int year, month, day, expected_year, expected_month, expected_day;
+    TEST_ASSERT_TRUE(sscanf_parse_date(&expected_year, &expected_month,
+                                       &expected_day,
+                                       field(buf, date_fields[i])));
+    TEST_ASSERT_TRUE(
+        parse_date(&year, &month, &day, field(buf, date_fields[i])));
+    TEST_ASSERT_EQUAL(expected_year, year);
+    TEST_ASSERT_EQUAL(expected_month, month);
+    TEST_ASSERT_EQUAL(expected_day, day);
+  }
+}
+
+// Whole sentences and the values they must produce
+struct GoldenFix {
+  const char* sentence;
+  double latitude;
+  double longitude;
+  float altitude;
+  int satellites;
+};
+
+static const GoldenFix golden_fixes[] = {
+    {"$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47",
+     48 + 7.038 / 60, 11 + 31.0 / 60, 545.4, 8},
+    {"$GPGGA,092750.000,5321.6802,N,00630.3372,W,1,8,1.03,61.7,M,55.2,M,,*76",
+     53 + 21.6802 / 60, -(6 + 30.3372 / 60), 61.7, 8},
+    {"$GNGGA,001043.00,4404.14036,S,12118.85961,W,2,12,0.98,-10.5,M,-21.3,M,,"
+     "*72",
+     -(44 + 4.14036 / 60), -(121 + 18.85961 / 60), -10.5, 12},
+};
+
+struct GoldenCourse {
+  const char* sentence;
+  float speed;   // m/s
+  float course;  // rad
+};
+
+static const GoldenCourse golden_courses[] = {
+    {"$GPRMC,220516,A,5133.82,N,00042.24,W,173.8,231.8,130694,004.2,W*70",
+     173.8 * 1852 / 3600, 231.8 * PI / 180},
+    {"$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A*25", 5.5 * 1852 / 3600,
+     54.7 * PI / 180},
+};
+
+void test_golden_sentences() {
+  for (size_t i = 0; i < NUM(golden_fixes); i++) {
+    NMEAData data;
+    NMEAParser parser;
+    parser.add_sentence_parser(new GGASentenceParser(&data));
+    const GoldenFix& fix = golden_fixes[i];
+    parser.handle(fix.sentence, strlen(fix.sentence));
+    parser.handle("\r\n", 2);
+    TEST_ASSERT_EQUAL(1, parser.get_counters().sentences);
+    TEST_ASSERT_EQUAL(0, parser.get_counters().parse_failures);
+    Position position = data.position.get();
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, fix.latitude, position.latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, fix.longitude, position.longitude);
+    TEST_ASSERT_EQUAL_FLOAT(fix.altitude, position.altitude);
+    TEST_ASSERT_EQUAL(fix.satellites, data.num_satellites.get());
+  }
+  for (size_t i = 0; i < NUM(golden_courses); i++) {
+    NMEAData data;
+    NMEAParser parser;
+    parser.add_sentence_parser(new RMCSentenceParser(&data));
+    parser.add_sentence_parser(new VTGSentenceParser(&data));
+    const GoldenCourse& golden = golden_courses[i];
+    parser.handle(golden.sentence, strlen(golden.sentence));
+    parser.handle("\r\n", 2);
+    TEST_ASSERT_EQUAL(1, parser.get_counters().sentences);
+    TEST_ASSERT_EQUAL(0, parser.get_counters().parse_failures);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, golden.speed, data.speed.get());
+    TEST_ASSERT_FLOAT_WITHIN(1e-5, golden.course, data.true_course.get());
+  }
+}
+
+// Rounds of the benchmark over all fields
+#define BENCHMARK_ROUNDS 200
+
+/// @return Microseconds spent parsing all fields BENCHMARK_ROUNDS times
+template <typename IntParser, typename DoubleParser, typename LatLonParser,
+          typename TimeParser>
+static uint32_t time_fields_with(IntParser parse_i, DoubleParser parse_d,
+                                 LatLonParser parse_ll, TimeParser parse_t) {
+  char buf[32];
+  int i_value;
+  double d_value;
+  int hour, minute;
+  float second;
+  uint32_t start = micros();
+  for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM(int_fields); i++) {
+      parse_i(&i_value, field(buf, int_fields[i]));
+    }
+    for (size_t i = 0; i < NUM(decimal_fields); i++) {
+      parse_d(&d_value, field(buf, decimal_fields[i]));
+    }
+    for (size_t i = 0; i < NUM(latlon_fields); i++) {
+      parse_ll(&d_value, field(buf, latlon_fields[i]));
+    }
+    for (size_t i = 0; i < NUM(time_fields); i++) {
+      parse_t(&hour, &minute, &second, field(buf, time_fields[i]));
+    }
+    yield();
+  }
+  return micros() - start;
+}
+
+void test_benchmark() {
+  const int fields = BENCHMARK_ROUNDS *
+                     (NUM(int_fields) + NUM(decimal_fields) +
+                      NUM(latlon_fields) + NUM(time_fields));
+  uint32_t baseline =
+      time_fields_with(sscanf_parse_int, sscanf_parse_double,
+                       sscanf_parse_latlon, sscanf_parse_time);
+  uint32_t elapsed =
+      time_fields_with(parse_int, parse_double, parse_latlon, parse_time);
+
+  NMEAData data;
+  NMEAParser parser;
+  parser.add_sentence_parser(new GGASentenceParser(&data));
+  parser.add_sentence_parser(new RMCSentenceParser(&data));
+  parser.add_sentence_parser(new VTGSentenceParser(&data));
+  uint32_t start = micros();
+  for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+    for (size_t i = 0; i < NUM(golden_fixes); i++) {
+      parser.handle(golden_fixes[i].sentence,
+                    strlen(golden_fixes[i].sentence));
+      parser.handle("\r\n", 2);
+    }
+    for (size_t i = 0; i < NUM(golden_courses); i++) {
+      parser.handle(golden_courses[i].sentence,
+                    strlen(golden_courses[i].sentence));
+      parser.handle("\r\n", 2);
+    }
+    yield();
+  }
+  uint32_t sentence_time = micros() - start;
+  int sentences = BENCHMARK_ROUNDS * (NUM(golden_fixes) + NUM(golden_courses));
+
+  char message[100];
+  snprintf(message, sizeof(message),
+           "fields: %.3f us (sscanf %.3f us); sentences: %.2f us",
+           (float)elapsed / fields, (float)baseline / fields,
+           (float)sentence_time / sentences);
+  TEST_MESSAGE(message);
+  TEST_ASSERT_EQUAL(sentences, parser.get_counters().sentences);
+  TEST_ASSERT_TRUE(elapsed < baseline);
+}
+
+ReactESP app([]() {
+  delay(2000);
+  UNITY_BEGIN();
+  RUN_TEST(test_int_matches_sscanf);
+  RUN_TEST(test_decimal_matches_sscanf);
+  RUN_TEST(test_latlon_matches_sscanf);
+  RUN_TEST(test_time_and_date_match_sscanf);
+  RUN_TEST(test_golden_sentences);
+  RUN_TEST(test_benchmark);
+  UNITY_END();
+});
@@ -0,0 +1,158 @@
+#include <Arduino.h>
+#include <unity.h>
+
+#include "sensesp.h"
+#include "system/nmea_parser.h"
+
+// Feeds a sentence with its checksum and CR LF appended
+static void feed(NMEAParser& parser, const String& body) {
+  uint8_t checksum = 0;
+  for (size_t i = 0; i < body.length(); i++) {
+    checksum ^= body[i];
+  }
+  char tail[6];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+  String sentence = "$" + body + tail;
+  parser.handle(sentence.c_str(), sentence.length());
+}
+
+void test_parse_int_sign() {
+  int value = 0;
+  char s1[] = "-12";
+  TEST_ASSERT_TRUE(parse_int(&value, s1));
+  TEST_ASSERT_EQUAL(-12, value);
+  char s2[] = "+7";
+  TEST_ASSERT_TRUE(parse_int(&value, s2));
+  TEST_ASSERT_EQUAL(7, value);
+  char s3[] = "-";
+  TEST_ASSERT_FALSE(parse_int(&value, s3));
+  char s4[] = "1-2";
+  TEST_ASSERT_FALSE(parse_int(&value, s4));
+  TEST_ASSERT_EQUAL(7, value);
+}
+
+void test_parse_double_sign() {
+  double value = 0;
+  char s1[] = "-0.25";
+  TEST_ASSERT_TRUE(parse_double(&value, s1));
+  TEST_ASSERT_EQUAL_DOUBLE(-0.25, value);
+  char s2[] = "+545.4";
+  TEST_ASSERT_TRUE(parse_double(&value, s2));
+  TEST_ASSERT_EQUAL_DOUBLE(545.4, value);
+  char s3[] = "-.";
+  TEST_ASSERT_FALSE(parse_double(&value, s3));
+  float f = 0;
+  char s4[] = "-12.5";
+  TEST_ASSERT_TRUE(parse_float(&f, s4));
+  TEST_ASSERT_EQUAL_FLOAT(-12.5, f);
+}
+
+void test_parse_long_fraction() {
+  double value = 1;
+  // more leading zeros in the fraction than the mantissa can scale
+  char s1[] = "0.0000000000000000000001";
+  TEST_ASSERT_TRUE(parse_double(&value, s1));
+  TEST_ASSERT_EQUAL_DOUBLE(0, value);
+  char s2[] = "1.0000000000000000000001";
+  TEST_ASSERT_TRUE(parse_double(&value, s2));
+  TEST_ASSERT_EQUAL_DOUBLE(1, value);
+  char s3[] = "-0.000000000000000001234";
+  TEST_ASSERT_TRUE(parse_double(&value, s3));
+  TEST_ASSERT_DOUBLE_WITHIN(1e-18, 0, value);
+  float f = 1;
+  TEST_ASSERT_TRUE(parse_float(&f, s1));
+  TEST_ASSERT_EQUAL_FLOAT(0, f);
+  char s4[] = "4807.0000000000000000000001";
+  TEST_ASSERT_TRUE(parse_latlon(&value, s4));
+  TEST_ASSERT_EQUAL_DOUBLE(48 + 7.0 / 60, value);
+}
+
+void test_parse_latlon() {
+  double value = 0;
+  char s1[] = "4807.038";
+  TEST_ASSERT_TRUE(parse_latlon(&value, s1));
+  TEST_ASSERT_EQUAL_DOUBLE(48 + 7.038 / 60, value);
+  char s2[] = "01131.000";
+  TEST_ASSERT_TRUE(parse_latlon(&value, s2));
+  TEST_ASSERT_EQUAL_DOUBLE(11 + 31.0 / 60, value);
+  // the minutes keep all their digits
+  char s3[] = "12359.9999999";
+  TEST_ASSERT_TRUE(parse_latlon(&value, s3));
+  TEST_ASSERT_DOUBLE_WITHIN(1e-12, 123 + 59.9999999 / 60, value);
+  // the sign is given by the hemisphere only
+  char s4[] = "-4807.038";
+  TEST_ASSERT_FALSE(parse_latlon(&value, s4));
+  char s5[] = "";
+  TEST_ASSERT_FALSE(parse_latlon(&value, s5));
+}
+
+void test_parse_hemisphere() {
+  double value = 10;
+  char n[] = "N", s[] = "S", e[] = "E", w[] = "W", x[] = "X";
+  TEST_ASSERT_TRUE(parse_NS(&value, n));
+  TEST_ASSERT_EQUAL_DOUBLE(10, value);
+  TEST_ASSERT_TRUE(parse_NS(&value, s));
+  TEST_ASSERT_EQUAL_DOUBLE(-10, value);
+  TEST_ASSERT_TRUE(parse_EW(&value, e));
+  TEST_ASSERT_EQUAL_DOUBLE(-10, value);
+  TEST_ASSERT_TRUE(parse_EW(&value, w));
+  TEST_ASSERT_EQUAL_DOUBLE(10, value);
+  TEST_ASSERT_FALSE(parse_NS(&value, e));
+  TEST_ASSERT_FALSE(parse_EW(&value, x));
+}
+
+void test_gga_position_sign() {
+  NMEAData data;
+  NMEAParser parser;
+  parser.add_sentence_parser(new GGASentenceParser(&data));
+  feed(parser, "GPGGA,123519,4807.038,S,01131.000,W,1,08,0.9,-12.5,M,46.9,M,,");
+  TEST_ASSERT_EQUAL(1, parser.get_counters().sentences);
+  TEST_ASSERT_EQUAL(0, parser.get_counters().parse_failures);
+  Position position = data.position.get();
+  TEST_ASSERT_EQUAL_DOUBLE(-(48 + 7.038 / 60), position.latitude);
+  TEST_ASSERT_EQUAL_DOUBLE(-(11 + 31.0 / 60), position.longitude);
+  TEST_ASSERT_EQUAL_FLOAT(-12.5, position.altitude);
+}
+
+void test_overflow_edge() {
+  NMEAData data;
+  NMEAParser parser;
+  // "$", the body, "*hh" and CR LF: the longest body that fits is
+  // INPUT_BUFFER_LENGTH - 4 characters
+  String body = "GPXXX,";
+  while (body.length() < INPUT_BUFFER_LENGTH - 4) {
+    body += '1';
+  }
+  feed(parser, body);
+  TEST_ASSERT_EQUAL(1, parser.get_counters().sentences);
+  TEST_ASSERT_EQUAL(0, parser.get_counters().overflows);
+
+  feed(parser, body + "1");
+  TEST_ASSERT_EQUAL(1, parser.get_counters().sentences);
+  TEST_ASSERT_EQUAL(1, parser.get_counters().overflows);
+
+  // too many terms
+  String terms = "GPXXX";
+  for (int i = 0; i < MAX_TERMS; i++) {
+    terms += ",";
+  }
+  feed(parser, terms);
+  TEST_ASSERT_EQUAL(2, parser.get_counters().overflows);
+
+  // the parser recovers at the next sentence
+  feed(parser, "GPXXX,1");
+  TEST_ASSERT_EQUAL(2, parser.get_counters().sentences);
+}
+
+ReactESP app([]() {
+  delay(2000);
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_int_sign);
+  RUN_TEST(test_parse_double_sign);
+  RUN_TEST(test_parse_long_fraction);
+  RUN_TEST(test_parse_latlon);
+  RUN_TEST(test_parse_hemisphere);
+  RUN_TEST(test_gga_position_sign);
+  RUN_TEST(test_overflow_edge);
+  UNITY_END();
+});
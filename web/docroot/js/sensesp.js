@@ -106,12 +106,14 @@ class TreeList {
  }
  
 var globalEditor = null;
+var liveValueSocket = null;
 
 function getEmptyMountDiv() {
 
     var main = document.getElementById("mountNode");
     main.empty();
     globalEditor = null;
+    closeLiveValues();
     return main;
 }
 
@@ -124,7 +126,18 @@ function editConfig(config_path) {
 
     .then(response => {
 
+        // the schema is served separately, so that the browser can
+        // cache it
         var json = JSON.parse(response);
+        return ajax('GET', '/schema/' + json.schema_id)
+        .then(schemaResponse => {
+            json.schema = JSON.parse(schemaResponse);
+            return json;
+        });
+    })
+
+    .then(json => {
+
         var config = json.config;
         var schema = json.schema;
 
@@ -140,6 +153,9 @@ function editConfig(config_path) {
 
         main.innerHTML = `
         <div class='row'>
+        <div id='live_value' class='medium-12 columns'></div>
+        </div>
+        <div class='row'>
         <div id='editor_holder' class='medium-12 columns'></div>        
         </div>
         <div class='row'>
@@ -162,6 +178,8 @@ function editConfig(config_path) {
                                         'show_opt_in': true,
                                         });        
 
+        showLiveValue(config_path);
+
         document.getElementById('submit').addEventListener('click',function() {
             saveConfig(config_path, globalEditor.getValue());
         });
@@ -198,6 +216,41 @@ function editConfig(config_path) {
 }
 
 
+function showLiveValue(config_path) {
+
+    // current values are not part of the configuration; the device
+    // pushes them as they change
+    var holder = document.getElementById('live_value');
+    var show = values => {
+        var value = values[config_path];
+        if (value !== undefined) {
+            holder.textContent = `Current value: ${value}`;
+        }
+    };
+    var socket = new WebSocket(`ws://${location.host}/values/stream`);
+    socket.onopen = () => {
+        socket.send(JSON.stringify({ subscribe: [config_path], interval: 500 }));
+    };
+    socket.onmessage = event => show(JSON.parse(event.data));
+    socket.onerror = () => {
+        // no WebSocket, e.g. in the mock environment: read the value once
+        ajax('GET', '/values?prefix=' + encodeURIComponent(config_path))
+        .then(response => show(JSON.parse(response)))
+        .catch(err => {});
+    };
+    liveValueSocket = socket;
+}
+
+
+function closeLiveValues() {
+    if (liveValueSocket) {
+        liveValueSocket.onerror = null;
+        liveValueSocket.close();
+        liveValueSocket = null;
+    }
+}
+
+
 function saveConfig(config_path, values) {
 
     ajax('PUT', '/config' + config_path, JSON.stringify(values), 'application/json')